@@ -0,0 +1,103 @@
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Pots read from the ADC samples DMA keeps writing to a fixed array, smoothed at a fixed control rate.
+// Each channel runs a one-pole low pass with hysteresis and queues a change event when its value moves,
+// so the control loop only handles events and never reads or filters the ADC itself.
+
+// new value of one channel
+struct ControlEvent
+{
+    uint8_t channel{};
+    float value{};      //> smoothed value in range 0.0f to 1.0f
+};
+
+template <int CHANNELS>
+class ControlInputs
+{
+public:
+    static constexpr float DEFAULT_RATE{1000.0f};   //> filter updates per second
+    static constexpr size_t QUEUE_SIZE{32};         //> events held until the control loop polls
+
+    ControlInputs() {}
+
+    // sample_rate is the rate of the frames passed to process, rate is the number of filter updates per second
+    void init(float sample_rate, float rate = DEFAULT_RATE)
+    {
+        _period = static_cast<int>(sample_rate / rate + 0.5f);
+        if (_period < 1) {_period = 1;}
+        _coefficient = 1.0f - std::exp(-TWO_PI * SMOOTHING / rate);
+        _countdown = 0;
+    }
+    // reads channel from raw, the 16 bit sample DMA writes for it, reversed channels read 1.0f at the low end of the pot
+    // the filter starts at the current position and the next update queues it, call before audio starts
+    void setSource(int channel, const volatile uint16_t* raw, bool reverse = false)
+    {
+        _raw[channel] = raw;
+        _reverse[channel] = reverse;
+        _value[channel] = read(channel);
+        _pending[channel] = true;
+    }
+
+    /// audio callback side
+
+    // advances the control clock by frames and updates every channel each time a period has passed
+    void process(size_t frames)
+    {
+        _countdown -= static_cast<int>(frames);
+        while (_countdown <= 0)
+        {
+            _countdown += _period;
+            update();
+        }
+    }
+
+    /// control loop side
+
+    // takes the oldest change, returns false if there is none
+    bool poll(ControlEvent& event) {return _events.pop(event);}
+
+private:
+    static constexpr float TWO_PI{6.28318530717958647692f};
+    static constexpr float SMOOTHING{20.0f};    //> low pass cutoff in Hz, fast enough to follow a quick turn
+    static constexpr float HYSTERESIS{0.004f};  //> change needed for a new event, above the ADC noise of a resting pot
+    static constexpr float SNAP{0.01f};         //> values this close to either end are pinned to it
+
+    const volatile uint16_t* _raw[CHANNELS]{};  //> DMA sample of each channel, nullptr if unused
+    bool _reverse[CHANNELS]{};
+    float _value[CHANNELS]{};       //> low pass state
+    float _sent[CHANNELS]{};        //> value of the last queued event
+    bool _pending[CHANNELS]{};      //> true when a value must be queued regardless of hysteresis
+    SpscQueue<ControlEvent, QUEUE_SIZE> _events{};
+    int _period{1};                 //> frames between updates
+    int _countdown{};               //> frames left until the next update
+    float _coefficient{1.0f};       //> one-pole coefficient for SMOOTHING at the update rate
+
+    // returns current ADC sample of channel in range 0.0f to 1.0f
+    float read(int channel) const
+    {
+        const float value {static_cast<float>(*_raw[channel]) * (1.0f / 65536.0f)};
+        return _reverse[channel] ? 1.0f - value : value;
+    }
+    // filters every channel and queues those that moved past the hysteresis
+    void update()
+    {
+        for (int channel{0}; channel < CHANNELS; channel++)
+        {
+            if (_raw[channel] == nullptr) {continue;}
+            _value[channel] += _coefficient * (read(channel) - _value[channel]);
+            float value {_value[channel]};
+            if (value < SNAP) {value = 0.0f;}
+            else if (value > 1.0f - SNAP) {value = 1.0f;}
+            if (!_pending[channel] && std::abs(value - _sent[channel]) <= HYSTERESIS) {continue;}
+            // a full queue leaves the channel pending so its latest value goes out with a later update
+            _pending[channel] = !_events.push({static_cast<uint8_t>(channel), value});
+            if (!_pending[channel]) {_sent[channel] = value;}
+        }
+    }
+};
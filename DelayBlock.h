@@ -0,0 +1,59 @@
+#pragma once
+
+#include "DelayModulation.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// Sub-block sizes that trade latency for cpu per frame.
+// Engines split every process call into sub-blocks and apply controls at each sub-block start,
+// so the host may pass any block size and the output only depends on the mode.
+enum class BlockMode
+{
+    LOW_LATENCY,    //> 4 frames, firmware default
+    BALANCED,       //> 16 frames
+    EFFICIENT,      //> 48 frames
+    THROUGHPUT      //> 128 frames, for large voice counts
+};
+
+// returns frames per sub-block of mode, use it as the host block size to avoid splitting
+constexpr int blockModeFrames(BlockMode mode)
+{
+    return mode == BlockMode::THROUGHPUT ? 128
+        : mode == BlockMode::EFFICIENT ? 48
+        : mode == BlockMode::BALANCED ? 16
+        : 4;
+}
+// returns samples between flutter and pan updates in mode, they never need updating more often than CONTROL_INTERVAL
+// and are kept to MAX_CONTROL_INTERVAL so the mode doesn't change how the flutter sounds
+constexpr int blockModeInterval(BlockMode mode) {return std::min(std::max(blockModeFrames(mode), CONTROL_INTERVAL), MAX_CONTROL_INTERVAL);}
+
+// Splits process calls into sub-blocks that start at fixed frames counted across calls.
+class SubBlockClock
+{
+public:
+    SubBlockClock() {}
+
+    // set frames per sub-block, the next frame starts a sub-block
+    void setFrames(int frames) {_frames = std::max(1, frames); _countdown = 0;}
+    int getFrames() const {return _frames;}
+    // calls process(offset, frames, start) for each piece of a size frame block, start is true when a sub-block begins at offset
+    template <typename Process>
+    void split(size_t size, Process process)
+    {
+        size_t offset{0};
+        while (offset < size)
+        {
+            const bool start {_countdown == 0};
+            if (start) {_countdown = _frames;}
+            const size_t frames {std::min(size - offset, static_cast<size_t>(_countdown))};
+            process(offset, frames, start);
+            offset += frames;
+            _countdown -= static_cast<int>(frames);
+        }
+    }
+
+private:
+    int _frames{blockModeFrames(BlockMode::LOW_LATENCY)};
+    int _countdown{};   //> frames left in the current sub-block
+};
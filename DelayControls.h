@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Engine controls that change while audio runs.
+// The control loop writes them to a snapshot that the audio callback applies as a whole at the start of a block.
+struct DelayControls
+{
+    // voices that can be bypassed through bypass_mask
+    static constexpr int MAX_BYPASS_VOICES{64};
+
+    float master_delay_time{};  //> master delay time in samples
+    float master_feedback{};
+    float master_flutter{};
+    uint64_t bypass_mask{};     //> bit n set when voice n is bypassed
+    bool ping_pong{};
+};
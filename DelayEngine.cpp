@@ -1,44 +1,92 @@
 #include "DelayEngine.h"
 
-void DelayEngine::init(float* buffer1, float* buffer2, int max_delay, int voice_count, int sample_rate)
+void DelayEngine::initParameters(Layout layout, int line_size, int voice_count, const float* max_ratios)
 {
-    // zero buffer
-    for (int i{0}; i < max_delay * voice_count; i++)
-    {
-        buffer1[i] = 0;
-        buffer2[i] = 0;
-    }
+    _layout = layout;
     // allocate voice array
-    _voices = new DelayVoice[voice_count];
-    // init voices
-    for (int voice_id{0}; voice_id < voice_count; voice_id++)
-    {
-        _voices[voice_id].init(buffer1 + max_delay * voice_id, buffer2 + max_delay * voice_id, max_delay, sample_rate);
-    }
+    if (_layout == Layout::VOICES) {_voices = new DelayVoice[voice_count];}
+    _voice_count = voice_count;
+    // new voices or the bank take the engine's seed
+    setSeed(_noise_seed);
 
     // allocate ratio array
     _ratios = new float[voice_count];
-    // init all ratios to 1.0f
+    // init ratios to the largest each voice was planned for
     for (int voice_id{0}; voice_id < voice_count; voice_id++)
     {
-        _ratios[voice_id] = 1.0f;
+        _ratios[voice_id] = max_ratios != nullptr ? enforceRatio(max_ratios[voice_id]) : 1.0f;
     }
 
     // store member variables
-    _voice_count = voice_count;
-    _max_delay = max_delay;
+    _max_delay = line_size;
+    _block_clock.setFrames(blockModeFrames(_block_mode));
+    // voices start from defaults, so controls of an earlier init must be applied again
+    _controls = {};
+    _applied = {};
+    // a preset recalled before init doesn't run again
+    _morph = _preset;
+    _morph_block = _morph.blocks;
+    _preset_done.store(_preset.id, std::memory_order_release);
 }
 
 void DelayEngine::process(float left, float right)
 {
+    float left_out{};
+    float right_out{};
+    process(&left, &right, &left_out, &right_out, 1);
+}
+
+void DelayEngine::process(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    // controls are applied at sub-block starts counted across calls, so the host block size doesn't change the output
+    _block_clock.split(size, [&](size_t offset, size_t frames, bool start)
+    {
+        if (start)
+        {
+            applyControls();
+            applyPreset();
+            startSubBlock();
+        }
+        processSubBlock(in_left + offset, in_right + offset, out_left + offset, out_right + offset, frames);
+    });
+}
+
+void DelayEngine::startSubBlock()
+{
+    if (_layout != Layout::VOICES)
+    {
+        _bank.startSubBlock();
+        return;
+    }
+    for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+    {
+        _voices[voice_id].startSubBlock();
+    }
+}
+
+void DelayEngine::processSubBlock(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    if (_layout != Layout::VOICES)
+    {
+        _bank.process(in_left, in_right, out_left, out_right, size);
+        return;
+    }
+    // clear output, each active voice adds to it
+    for (size_t i{0}; i < size; i++)
+    {
+        out_left[i] = 0.0f;
+        out_right[i] = 0.0f;
+    }
+    // voices are the outer loop so each voice runs the whole block with its state held locally
     for (int voice_id{0}; voice_id < _voice_count; voice_id++)
     {
-        _voices[voice_id].process(left, right);
+        _voices[voice_id].process(in_left, in_right, out_left, out_right, size);
     }
 }
 
 float DelayEngine::getLeft()
 {
+    if (_layout != Layout::VOICES) {return _bank.getLeft();}
     float left_out {0.0f};
     for (int voice_id{0}; voice_id < _voice_count; voice_id++)
     {
@@ -49,6 +97,7 @@ float DelayEngine::getLeft()
 
 float DelayEngine::getRight()
 {
+    if (_layout != Layout::VOICES) {return _bank.getRight();}
     float right_out {0.0f};
     for (int voice_id{0}; voice_id < _voice_count; voice_id++)
     {
@@ -62,56 +111,285 @@ void DelayEngine::setMasterDelayTime(float samples)
     // ensure samples are in range
     if (samples < 0.01f) {samples = 0.01f;}
     else if (samples >= _max_delay) {samples = _max_delay - 1;}
-    _master_delay_time = samples;
+    _controls.master_delay_time = samples;
+    publishControls();
+}
+
+void DelayEngine::setMasterFeedback(float feedback)
+{
+    // ensure feedback is in range
+    _controls.master_feedback = enforceRatio(feedback);
+    publishControls();
+}
+
+void DelayEngine::setMasterFlutter(float flutter)
+{
+    // ensure flutter is in range
+    _controls.master_flutter = enforceRatio(flutter);
+    publishControls();
+}
+
+void DelayEngine::setPingPongMode(bool b)
+{
+    _controls.ping_pong = b;
+    publishControls();
+}
+
+void DelayEngine::setBypass(int voice_id, bool b)
+{
+    if (voice_id < 0 || voice_id >= std::min(_voice_count, DelayControls::MAX_BYPASS_VOICES)) {return;}
+    const uint64_t bit {uint64_t{1} << voice_id};
+    _controls.bypass_mask = b ? _controls.bypass_mask | bit : _controls.bypass_mask & ~bit;
+    publishControls();
+}
+
+void DelayEngine::setDelayRatio(int voice_id, float ratio)
+{
+    _ratios[voice_id] = enforceRatio(ratio);
+}
+
+void DelayEngine::setPan(int voice_id, float pan)
+{
+    pan = enforceRatio(pan);
+    if (_layout != Layout::VOICES) {_bank.setPan(voice_id, pan);}
+    else {_voices[voice_id].setPan(pan);}
+}
+
+void DelayEngine::setDetune(int voice_id, float detune)
+{
+    if (_layout != Layout::VOICES) {_bank.setDetune(voice_id, detune);}
+    else {_voices[voice_id].setDetune(detune);}
+}
+
+void DelayEngine::setControlInterval(int samples)
+{
+    if (_layout != Layout::VOICES)
+    {
+        _bank.setControlInterval(samples);
+        return;
+    }
+    for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+    {
+        _voices[voice_id].setControlInterval(samples);
+    }
+}
 
-    // set delay time per voice according to each voice's ratio
+void DelayEngine::setInterpolation(Interpolation interpolation)
+{
+    if (_layout != Layout::VOICES)
+    {
+        _bank.setInterpolation(interpolation);
+        return;
+    }
     for (int voice_id{0}; voice_id < _voice_count; voice_id++)
     {
-        _voices[voice_id].setDelayTime(_master_delay_time * _ratios[voice_id]);
+        _voices[voice_id].setInterpolation(interpolation);
     }
 }
 
-void DelayEngine::setMasterFeedback(float feedback)
+void DelayEngine::setBlockMode(BlockMode mode)
 {
-    // ensure feedback is in range
-    _master_feedback = enforceRatio(feedback);
+    _block_mode = mode;
+    _block_clock.setFrames(blockModeFrames(mode));
+    setControlInterval(blockModeInterval(mode));
+}
 
-    // set feedback for each voice
+void DelayEngine::setSleep(bool b)
+{
+    if (_layout != Layout::VOICES)
+    {
+        _bank.setSleep(b);
+        return;
+    }
     for (int voice_id{0}; voice_id < _voice_count; voice_id++)
     {
-        _voices[voice_id].setFeedback(_master_feedback);
+        _voices[voice_id].setSleep(b);
     }
 }
 
-void DelayEngine::setMasterFlutter(float flutter)
+void DelayEngine::setSeed(uint32_t seed)
 {
-    // ensure flutter is in range
-    _master_flutter = enforceRatio(flutter);
-
-    // set flutter for each voice
+    _noise_seed = seed;
+    if (_layout != Layout::VOICES)
+    {
+        _bank.setSeed(seed);
+        return;
+    }
+    // voices take the streams the bank would give them
     for (int voice_id{0}; voice_id < _voice_count; voice_id++)
     {
-        _voices[voice_id].setFlutter(_master_flutter);
+        _voices[voice_id].setSeed(seed, static_cast<uint32_t>(voice_id));
     }
 }
 
-void DelayEngine::setPingPongMode(bool b)
+void DelayEngine::capture(DelayPreset& preset) const
+{
+    preset.controls = _controls;
+    const int preset_voices {std::min(_voice_count, DelayPreset::MAX_VOICES)};
+    for (int voice_id{0}; voice_id < preset_voices; voice_id++)
+    {
+        preset.ratio[voice_id] = _ratios[voice_id];
+        if (_layout != Layout::VOICES)
+        {
+            preset.pan[voice_id] = _bank.getPan(voice_id);
+            preset.detune[voice_id] = _bank.getDetune(voice_id);
+        }
+        else
+        {
+            preset.pan[voice_id] = _voices[voice_id].getPan();
+            preset.detune[voice_id] = _voices[voice_id].getDetune();
+        }
+    }
+}
+
+void DelayEngine::morph(const DelayPreset* from, const DelayPreset* to, int frames)
+{
+    if (to == nullptr) {return;}
+    if (from == nullptr) {from = to;}
+    _preset = {from, to, presetBlocks(frames, blockModeFrames(_block_mode)), _preset.id + 1};
+    // later control changes start from the preset's values
+    _controls = to->controls;
+    publishControls();
+}
+
+int DelayEngine::getSleepingVoices() const
 {
+    if (_layout != Layout::VOICES) {return _bank.getSleepingVoices();}
+    int sleeping {0};
     for (int voice_id{0}; voice_id < _voice_count; voice_id++)
     {
-        _voices[voice_id].setPingPongMode(b);
+        if (_voices[voice_id].getSleeping()) {sleeping++;}
     }
+    return sleeping;
 }
 
-void DelayEngine::setDelayRatio(int voice_id, float ratio)
+void DelayEngine::publishControls()
 {
-    _ratios[voice_id] = enforceRatio(ratio);
+    _handoff.write() = {_controls, _preset};
+    _handoff.publish();
 }
 
-void DelayEngine::setPan(int voice_id, float pan)
+void DelayEngine::applyControls()
 {
-    pan = enforceRatio(pan);
-    _voices[voice_id].setPan(pan);
+    if (!_handoff.update()) {return;}
+    const DelayHandoff& handoff {_handoff.read()};
+    if (handoff.preset.id != _morph.id)
+    {
+        _morph = handoff.preset;
+        _morph_block = 0;
+    }
+    // controls published with or during a morph are applied when it ends
+    if (_morph_block < _morph.blocks) {return;}
+    applyControlValues(handoff.controls);
+}
+
+void DelayEngine::applyControlValues(const DelayControls& controls)
+{
+    const bool packed {_layout != Layout::VOICES};
+
+    // only changed values are applied, reapplying delay time would undo flutter drift
+    if (controls.master_delay_time != _applied.master_delay_time)
+    {
+        // set delay time per voice according to each voice's ratio
+        for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+        {
+            const float samples {controls.master_delay_time * _ratios[voice_id]};
+            if (packed) {_bank.setDelayTime(voice_id, samples);}
+            else {_voices[voice_id].setDelayTime(samples);}
+        }
+    }
+    if (controls.master_feedback != _applied.master_feedback)
+    {
+        for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+        {
+            if (packed) {_bank.setFeedback(voice_id, controls.master_feedback);}
+            else {_voices[voice_id].setFeedback(controls.master_feedback);}
+        }
+    }
+    if (controls.master_flutter != _applied.master_flutter)
+    {
+        for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+        {
+            if (packed) {_bank.setFlutter(voice_id, controls.master_flutter);}
+            else {_voices[voice_id].setFlutter(controls.master_flutter);}
+        }
+    }
+    if (controls.ping_pong != _applied.ping_pong)
+    {
+        if (packed) {_bank.setPingPongMode(controls.ping_pong);}
+        else
+        {
+            for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+            {
+                _voices[voice_id].setPingPongMode(controls.ping_pong);
+            }
+        }
+    }
+    if (controls.bypass_mask != _applied.bypass_mask)
+    {
+        const int bypass_voices {std::min(_voice_count, DelayControls::MAX_BYPASS_VOICES)};
+        for (int voice_id{0}; voice_id < bypass_voices; voice_id++)
+        {
+            const bool b {((controls.bypass_mask >> voice_id) & 1) != 0};
+            if (packed) {_bank.setBypass(voice_id, b);}
+            else {_voices[voice_id].setBypass(b);}
+        }
+    }
+    _applied = controls;
+}
+
+void DelayEngine::applyPreset()
+{
+    if (_morph_block >= _morph.blocks) {return;}
+    const DelayPreset& from {*_morph.from};
+    const DelayPreset& to {*_morph.to};
+    const bool first {_morph_block == 0};
+    _morph_block++;
+    const float amount {static_cast<float>(_morph_block) / static_cast<float>(_morph.blocks)};
+    const bool packed {_layout != Layout::VOICES};
+
+    // switches can't be blended, they take the nearer preset's value
+    DelayControls controls {amount < 0.5f ? from.controls : to.controls};
+    controls.master_delay_time = presetMix(from.controls.master_delay_time, to.controls.master_delay_time, amount);
+    controls.master_feedback = presetMix(from.controls.master_feedback, to.controls.master_feedback, amount);
+    controls.master_flutter = presetMix(from.controls.master_flutter, to.controls.master_flutter, amount);
+    const bool master_moved {controls.master_delay_time != _applied.master_delay_time};
+
+    // voice values both presets share are only set on the first sub-block, reapplying delay time would undo flutter drift
+    const int preset_voices {std::min(_voice_count, DelayPreset::MAX_VOICES)};
+    for (int voice_id{0}; voice_id < preset_voices; voice_id++)
+    {
+        if (first || from.ratio[voice_id] != to.ratio[voice_id])
+        {
+            _ratios[voice_id] = enforceRatio(presetMix(from.ratio[voice_id], to.ratio[voice_id], amount));
+            // a moving master delay time sets every voice below
+            if (!master_moved)
+            {
+                const float samples {controls.master_delay_time * _ratios[voice_id]};
+                if (packed) {_bank.setDelayTime(voice_id, samples);}
+                else {_voices[voice_id].setDelayTime(samples);}
+            }
+        }
+        if (first || from.pan[voice_id] != to.pan[voice_id])
+        {
+            // the ping pong lfo keeps its phase, setPan would shift it on every sub-block
+            const float pan {presetMix(from.pan[voice_id], to.pan[voice_id], amount)};
+            if (packed) {_bank.movePan(voice_id, pan);}
+            else {_voices[voice_id].movePan(pan);}
+        }
+        if (first || from.detune[voice_id] != to.detune[voice_id])
+        {
+            const float detune {presetMix(from.detune[voice_id], to.detune[voice_id], amount)};
+            if (packed) {_bank.setDetune(voice_id, detune);}
+            else {_voices[voice_id].setDetune(detune);}
+        }
+    }
+    applyControlValues(controls);
+
+    if (_morph_block < _morph.blocks) {return;}
+    // controls set since the request differ from to only where they were changed
+    applyControlValues(_handoff.read().controls);
+    _preset_done.store(_morph.id, std::memory_order_release);
 }
 
 float DelayEngine::enforceRatio(float x)
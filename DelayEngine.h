@@ -1,25 +1,74 @@
 #pragma once
 
+#include "DelayBlock.h"
+#include "DelayControls.h"
+#include "DelayMemory.h"
+#include "DelayPreset.h"
 #include "DelayVoice.h"
+#include "DelayVoiceBank.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
 
 class DelayEngine
 {
 public:
+    // how voice state is stored
+    enum class Layout
+    {
+        VOICES,     //> one DelayVoice object per voice
+        PACKED,     //> voice parameters in parallel arrays with one shared write position
+        TAPS        //> PACKED voices as read heads on one shared delay line, memory doesn't grow with voice count
+    };
+
     DelayEngine()
     :_voices{nullptr} {}
 
     ~DelayEngine() { delete[] _voices; delete[] _ratios;}
+    // voices and ratios are owned, copies would share them
+    DelayEngine(const DelayEngine&) = delete;
+    DelayEngine& operator=(const DelayEngine&) = delete;
 
-    // initializes engines with max delay per voice, number of voices and sample rate -- Ensure buffer size is >= max_delay * voice_count
-    void init(float* buffer1, float* buffer2, int max_delay, int num_voices, int sample_rate);
+    // initializes engines with max delay per voice, number of voices and sample rate and returns the usable max delay in samples
+    // buffers may be float or int16_t (Q15) -- Ensure buffer size is >= bufferSize(max_delay, voice_count, layout, ring_mode, max_ratios)
+    // max_ratios holds the largest delay ratio each voice will be set to, or nullptr for 1.0f, and sets the initial ratios
+    // voices below 1.0f get shorter lines in the VOICES layout and in the PACKED layout with POWER_OF_TWO lines
+    template <typename Sample>
+    int init(Sample* buffer1, Sample* buffer2, int max_delay, int voice_count, int sample_rate, Layout layout = Layout::VOICES, RingMode ring_mode = RingMode::EXACT,
+        const float* max_ratios = nullptr);
+    // initializes engine with buffers taken from memory, placed in FAST or BULK memory by their size
+    // returns 0 if memory has no room, the engine must not be used then
+    template <typename Sample>
+    int init(DelayMemory& memory, int max_delay, int voice_count, int sample_rate, Layout layout = Layout::VOICES, RingMode ring_mode = RingMode::EXACT,
+        const float* max_ratios = nullptr);
+    // returns samples needed in each buffer passed to init
+    static constexpr int bufferSize(int max_delay, int voice_count, Layout layout = Layout::VOICES, RingMode ring_mode = RingMode::EXACT, const float* max_ratios = nullptr)
+    {
+        if (layout != Layout::VOICES) {return DelayVoiceBank::bufferSize(max_delay, voice_count, ring_mode, layout == Layout::TAPS, max_ratios);}
+        int size {0};
+        for (int voice_id{0}; voice_id < voice_count; voice_id++)
+        {
+            size += lineStride(ringSize(ratioDelay(max_delay, max_ratios != nullptr ? max_ratios[voice_id] : 1.0f), ring_mode));
+        }
+        return size;
+    }
+    // returns bytes of memory init takes from a DelayMemory
+    template <typename Sample>
+    static constexpr size_t memorySize(int max_delay, int voice_count, Layout layout = Layout::VOICES, RingMode ring_mode = RingMode::EXACT, const float* max_ratios = nullptr)
+    {
+        return DelayMemory::stereoSize(static_cast<size_t>(bufferSize(max_delay, voice_count, layout, ring_mode, max_ratios)) * sizeof(Sample));
+    }
     // processes new sample
     void process(float left, float right);
     void process(float in) {process(in * 0.5f, in * 0.5f);}
+    // processes a block of any size of stereo samples and writes the summed voice output -- out buffers must not alias in buffers
+    void process(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
     // get stereo output
     float getLeft();
     float getRight();
 
-    /// setters
+    /// control setters
+    // safe to call while audio runs, values are handed to the audio thread and applied together at the start of the next block
 
     // sets master delay time in samples
     void setMasterDelayTime(float samples);
@@ -29,36 +78,139 @@ public:
     void setMasterFlutter(float flutter);
     // set ping pong mode to on or off
     void setPingPongMode(bool b);
-    // set delay ratio of specific voice in range 0.0f to 1.0f
+    // set bypass of specific voice to true or false, only the first DelayControls::MAX_BYPASS_VOICES voices can be bypassed
+    void setBypass(int voice_id, bool b);
+
+    /// setup setters
+    // change voices directly, call before audio starts
+
+    // set delay ratio of specific voice in range 0.0f to 1.0f, takes effect with the next master delay time
+    // delay time stays within the line planned for the voice at init
     void setDelayRatio(int voice_id, float ratio);
     // set pan of specific voice in range 0.0f to 1.0f
     void setPan(int voice_id, float pan);
-    // set bypass of specific voice to true or false
-    void setBypass(int voice_id, bool b) {_voices[voice_id].setBypass(b);}
     // set detune in samples to stretch
-    void setDetune(int voice_id, float detune) {_voices[voice_id].setDetune(detune);}
+    void setDetune(int voice_id, float detune);
+    // set samples between flutter and pan updates, 1 updates every sample
+    void setControlInterval(int samples);
+    // set sub-block size controls are applied at and the matching flutter and pan interval, LOW_LATENCY by default
+    void setBlockMode(BlockMode mode);
+    // set how delay lines are read between samples, only POWER_OF_TWO lines use modes other than LINEAR
+    void setInterpolation(Interpolation interpolation);
+    // let voices whose lines have decayed to silence skip processing until new input arrives, on by default
+    // bypassed voices skip processing too and their lines are frozen until they return
+    // turn off to measure worst case load
+    void setSleep(bool b);
+    // set seed of the flutter noise, equal seeds give equal flutter and every voice gets its own stream of it
+    void setSeed(uint32_t seed);
+
+    /// presets
+    // the engine keeps pointers to recalled presets, they must stay unchanged until getMorphing returns false
+
+    // copies current parameters to preset, call while no morph runs
+    void capture(DelayPreset& preset) const;
+    // switches every parameter to preset at the start of the next block
+    void recall(const DelayPreset* preset) {morph(preset, preset, 0);}
+    // moves parameters from one preset to another over frames, rounded up to whole sub-blocks, starting with the next block
+    // values are interpolated once per sub-block, ping pong and bypass switch halfway
+    // controls set during a morph start from to and take effect when it ends, a new recall or morph replaces a running one
+    void morph(const DelayPreset* from, const DelayPreset* to, int frames);
 
     /// getters
 
     // returns delay time in samples
-    float getMasterDelayTime() const {return _master_delay_time;}
+    float getMasterDelayTime() const {return _controls.master_delay_time;}
     // returns feedback in range 0.0f to 1.0f
-    float getMasterFeedback() const {return _master_feedback;}
+    float getMasterFeedback() const {return _controls.master_feedback;}
     // returns flutter in range 0.0f to 1.0f
-    float getMasterFlutter() const {return _master_flutter;}
+    float getMasterFlutter() const {return _controls.master_flutter;}
     // returns voice count
     int getVoiceCount() const {return _voice_count;}
+    // returns max delay per voice in samples
+    int getMaxDelay() const {return _max_delay;}
+    // returns storage layout
+    Layout getLayout() const {return _layout;}
+    // returns sub-block size mode
+    BlockMode getBlockMode() const {return _block_mode;}
+    // returns seed of the flutter noise
+    uint32_t getSeed() const {return _noise_seed;}
+    // returns number of sleeping voices
+    int getSleepingVoices() const;
+    // returns true until the audio thread has finished the last recall or morph
+    bool getMorphing() const {return _preset_done.load(std::memory_order_acquire) != _preset.id;}
 
 private:
-    DelayVoice* _voices{};
+    Layout _layout{};
+    DelayVoice* _voices{};      //> used in VOICES layout
+    DelayVoiceBank _bank{};     //> used in PACKED and TAPS layouts
     int _voice_count{};
     int _max_delay{};           //> max delay time in samples determines how much space is to be allocated per voice
-    float* _ratios{};           //> ratios of per voice delay time to _master_delay_time
+    float* _ratios{};           //> ratios of per voice delay time to master delay time
+    uint32_t _noise_seed{NOISE_SEED};
     // control parameters
-    float _master_delay_time{}; //> master delay time in samples
-    float _master_feedback{};
-    float _master_flutter{};
+    DelayControls _controls{};                  //> latest values set by the control thread
+    DelayPresetRequest _preset{};               //> latest recall or morph made by the control thread
+    TripleBuffer<DelayHandoff> _handoff{};      //> passes _controls and _preset to the audio thread
+    DelayControls _applied{};                   //> values the audio thread has applied to the voices
+    // preset members
+    DelayPresetRequest _morph{};                //> recall or morph the audio thread is running
+    int _morph_block{};                         //> sub-blocks of _morph applied so far
+    std::atomic<uint32_t> _preset_done{0};      //> id of the last request the audio thread finished
+    // sub-block members
+    BlockMode _block_mode{BlockMode::LOW_LATENCY};
+    SubBlockClock _block_clock{};               //> finds sub-block starts in host blocks
 
+    // allocates voices and ratios and stores engine size, ratios start at max_ratios
+    void initParameters(Layout layout, int line_size, int voice_count, const float* max_ratios);
+    // tells voices a sub-block starts, they only fall asleep there
+    void startSubBlock();
+    // processes frames that lie within one sub-block
+    void processSubBlock(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
+    // hands a copy of _controls and _preset to the audio thread
+    void publishControls();
+    // takes the latest published controls and starts a new recall or morph, called by the audio thread before processing
+    // controls are applied unless a morph runs
+    void applyControls();
+    // applies values that differ from _applied to voices
+    void applyControlValues(const DelayControls& controls);
+    // applies the next sub-block of a running recall or morph, then the latest controls once it ends
+    void applyPreset();
     // ensures that x is between 0.0f and 1.0f
     float enforceRatio(float x);
-};
\ No newline at end of file
+};
+
+template <typename Sample>
+int DelayEngine::init(Sample* buffer1, Sample* buffer2, int max_delay, int voice_count, int sample_rate, Layout layout, RingMode ring_mode, const float* max_ratios)
+{
+    // delay lines may be longer than requested when rounded to a power of two
+    const int line_size {ringSize(max_delay, ring_mode)};
+    initParameters(layout, line_size, voice_count, max_ratios);
+
+    if (_layout != Layout::VOICES)
+    {
+        // bank zeroes its own delay lines
+        _bank.init(buffer1, buffer2, max_delay, voice_count, sample_rate, ring_mode, _layout == Layout::TAPS, max_ratios);
+    }
+    else
+    {
+        // init voices back to back, each voice zeroes its own delay lines
+        int line_offset {0};
+        for (int voice_id{0}; voice_id < voice_count; voice_id++)
+        {
+            const int voice_delay {ratioDelay(max_delay, _ratios[voice_id])};
+            _voices[voice_id].init(buffer1 + line_offset, buffer2 + line_offset, voice_delay, sample_rate, ring_mode);
+            line_offset += lineStride(ringSize(voice_delay, ring_mode));
+        }
+    }
+
+    return _max_delay;
+}
+
+template <typename Sample>
+int DelayEngine::init(DelayMemory& memory, int max_delay, int voice_count, int sample_rate, Layout layout, RingMode ring_mode, const float* max_ratios)
+{
+    Sample* left{};
+    Sample* right{};
+    if (!memory.allocateStereo(static_cast<size_t>(bufferSize(max_delay, voice_count, layout, ring_mode, max_ratios)), left, right)) {return 0;}
+    return init(left, right, max_delay, voice_count, sample_rate, layout, ring_mode, max_ratios);
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Places delay buffers in the memory tier that suits them.
+// Short modulated delays are bound by read latency, so they belong in fast on-chip SRAM/DTCM,
+// while long lines only fit in the large external SDRAM.
+// Every engine takes its lines from one DelayMemory, so arrays are sized by summing each engine's memorySize.
+
+// memory a buffer is placed in
+enum class MemoryTier
+{
+    FAST,   //> small on-chip SRAM/DTCM, no wait states
+    BULK    //> large external SDRAM, slower to read
+};
+
+// Hands out consecutive chunks of caller owned storage, nothing is freed until reset.
+class MemoryArena
+{
+public:
+    MemoryArena() {}
+
+    // storage must outlive every buffer allocated from the arena
+    void init(void* storage, size_t bytes) {_base = static_cast<uint8_t*>(storage); _capacity = storage != nullptr ? bytes : 0; _used = 0;}
+    // returns bytes of storage aligned to alignment, a power of two, or nullptr if the arena is full
+    void* allocate(size_t bytes, size_t alignment)
+    {
+        const uintptr_t start {(reinterpret_cast<uintptr_t>(_base) + _used + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)};
+        const size_t offset {static_cast<size_t>(start - reinterpret_cast<uintptr_t>(_base))};
+        if (_base == nullptr || offset > _capacity || bytes > _capacity - offset) {return nullptr;}
+        _used = offset + bytes;
+        return _base + offset;
+    }
+    // returns true if ptr points into the arena's storage
+    bool contains(const void* ptr) const
+    {
+        const uint8_t* p {static_cast<const uint8_t*>(ptr)};
+        return _base != nullptr && p >= _base && p < _base + _capacity;
+    }
+    // forgets every allocation, buffers handed out before must no longer be used
+    void reset() {_used = 0;}
+
+    size_t getCapacity() const {return _capacity;}
+    size_t getUsed() const {return _used;}
+    size_t getFree() const {return _capacity - _used;}
+
+private:
+    uint8_t* _base{};
+    size_t _capacity{};     //> bytes of storage
+    size_t _used{};         //> bytes handed out, including alignment padding
+};
+
+// Pair of arenas, one per tier, with a placement policy chosen by buffer size.
+// On the target the arenas are backed by arrays in DTCM and SDRAM sections, on the host by ordinary memory.
+class DelayMemory
+{
+public:
+    // buffers up to this many bytes go to FAST memory unless it is full
+    static constexpr size_t DEFAULT_FAST_LIMIT{16 * 1024};
+    // buffers start on a cache line, which also suits SIMD loads -- align storage given to init to this as well
+    static constexpr size_t ALIGNMENT{64};
+
+    // returns bytes rounded up to a whole number of cache lines
+    static constexpr size_t alignedSize(size_t bytes) {return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;}
+    // returns bytes of aligned storage taken by a left and right buffer of bytes each
+    static constexpr size_t stereoSize(size_t bytes) {return alignedSize(bytes) * 2;}
+
+    DelayMemory() {}
+
+    // give storage for each tier, either may be nullptr to leave the tier empty
+    void init(void* fast_storage, size_t fast_bytes, void* bulk_storage, size_t bulk_bytes)
+    {
+        _fast.init(fast_storage, fast_bytes);
+        _bulk.init(bulk_storage, bulk_bytes);
+    }
+    // forgets every buffer in both tiers so engines can be initialized from the memory again
+    void reset()
+    {
+        _fast.reset();
+        _bulk.reset();
+    }
+    // set largest buffer in bytes placed in FAST memory
+    void setFastLimit(size_t bytes) {_fast_limit = bytes;}
+
+    // returns tier count buffers of bytes each would be placed in, small buffers fall back to BULK when FAST is full
+    MemoryTier placement(size_t bytes, size_t count = 1) const
+    {
+        return bytes <= _fast_limit && alignedSize(bytes) * count <= _fast.getFree() ? MemoryTier::FAST : MemoryTier::BULK;
+    }
+    // returns buffer of samples placed by size, or nullptr if there is no room
+    template <typename Sample>
+    Sample* allocate(size_t samples) {return allocate<Sample>(samples, placement(samples * sizeof(Sample)));}
+    // returns buffer of samples from tier, or nullptr if there is no room
+    template <typename Sample>
+    Sample* allocate(size_t samples, MemoryTier tier)
+    {
+        static_assert(alignof(Sample) <= ALIGNMENT, "sample type needs more than cache line alignment");
+        // whole cache lines are taken so the next buffer starts aligned without padding
+        return static_cast<Sample*>(arena(tier).allocate(alignedSize(samples * sizeof(Sample)), ALIGNMENT));
+    }
+    // places a left and right buffer of samples in the same tier, returns false if there is no room
+    template <typename Sample>
+    bool allocateStereo(size_t samples, Sample*& left, Sample*& right)
+    {
+        const MemoryTier tier {placement(samples * sizeof(Sample), 2)};
+        left = allocate<Sample>(samples, tier);
+        right = allocate<Sample>(samples, tier);
+        return left != nullptr && right != nullptr;
+    }
+    // returns tier holding ptr, BULK if it came from neither arena
+    MemoryTier tierOf(const void* ptr) const {return _fast.contains(ptr) ? MemoryTier::FAST : MemoryTier::BULK;}
+
+    MemoryArena& arena(MemoryTier tier) {return tier == MemoryTier::FAST ? _fast : _bulk;}
+    const MemoryArena& arena(MemoryTier tier) const {return tier == MemoryTier::FAST ? _fast : _bulk;}
+    size_t getFastLimit() const {return _fast_limit;}
+
+private:
+    MemoryArena _fast{};
+    MemoryArena _bulk{};
+    size_t _fast_limit{DEFAULT_FAST_LIMIT};
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Control rate modulation sources shared by DelayVoice and DelayVoiceBank.
+// Flutter and ping pong pan move slowly, so they are updated every CONTROL_INTERVAL samples and ramped linearly in between.
+
+// default number of samples between flutter and pan updates
+static constexpr int CONTROL_INTERVAL{16};
+// longest interval that keeps the flutter depth, longer ones push the update rate down onto the 200Hz flutter low pass
+static constexpr int MAX_CONTROL_INTERVAL{48};
+
+// Sine LFO for ping pong panning, advanced once per control interval by rotating a unit vector instead of calling sin.
+class PanLfo
+{
+public:
+    PanLfo() {}
+
+    // interval is the number of samples between calls to process
+    void init(int sample_rate, int interval)
+    {
+        _sample_rate = sample_rate;
+        _interval = interval;
+        _sin = 0.0f;
+        _cos = 1.0f;
+        setFreq(_freq);
+    }
+    // change samples between calls to process, keeps phase
+    void setInterval(int interval)
+    {
+        _interval = interval;
+        setFreq(_freq);
+    }
+    // set frequency in Hz
+    void setFreq(float freq)
+    {
+        _freq = freq;
+        const float step {TWO_PI * _freq * static_cast<float>(_interval) / static_cast<float>(_sample_rate)};
+        _step_sin = std::sin(step);
+        _step_cos = std::cos(step);
+    }
+    // adds phase offset in range 0.0f to 1.0f, not for use in the audio loop
+    void phaseAdd(float phase) {rotate(std::sin(TWO_PI * phase), std::cos(TWO_PI * phase));}
+    // returns pan in range 0.0f to 1.0f and advances one interval
+    float process()
+    {
+        const float pan {0.5f + 0.5f * _sin};
+        rotate(_step_sin, _step_cos);
+        // pull the vector back to unit length so rounding doesn't grow or shrink the sine over time
+        const float correction {1.5f - 0.5f * (_sin * _sin + _cos * _cos)};
+        _sin *= correction;
+        _cos *= correction;
+        return pan;
+    }
+
+private:
+    static constexpr float TWO_PI{6.28318530717958647692f};
+
+    int _sample_rate{48000};
+    int _interval{1};
+    float _freq{1.0f};
+    float _sin{0.0f};       //> sine of current phase
+    float _cos{1.0f};       //> cosine of current phase
+    float _step_sin{};      //> rotation applied per interval
+    float _step_cos{1.0f};
+
+    void rotate(float s, float c)
+    {
+        const float sin {_sin * c + _cos * s};
+        _cos = _cos * c - _sin * s;
+        _sin = sin;
+    }
+};
+
+// gain of left channel for pan, the channel the voice is panned towards stays at full level
+inline float panLeftGain(float pan) {return std::min(1.0f, (1.0f - pan) * 2.0f);}
+// gain of right channel for pan
+inline float panRightGain(float pan) {return std::min(1.0f, pan * 2.0f);}
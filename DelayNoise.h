@@ -0,0 +1,112 @@
+#pragma once
+
+#include "DelaySimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Flutter noise for every voice of a bank, generated together once per control interval.
+// Each voice has its own xorshift32 stream and state variable low pass, with DELAY_SIMD four voices are stepped at once.
+// Streams start from a hash of the seed and the voice index, so voices are decorrelated and a seed always gives the same flutter.
+// A DelayVoice runs a bank of one on the stream of its index, so both layouts flutter alike.
+
+// seed used until one is set
+static constexpr uint32_t NOISE_SEED{0x9E3779B9u};
+
+// returns start state of a voice's stream, the pair is hashed so neighbouring seeds and voices give unrelated streams
+// never returns 0 since xorshift would stay there
+constexpr uint32_t noiseSeed(uint32_t seed, uint32_t stream)
+{
+    // murmur3 finalizer
+    uint32_t hash {seed ^ (stream * 0x85EBCA77u)};
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash != 0 ? hash : NOISE_SEED;
+}
+
+class FlutterNoiseBank
+{
+public:
+    FlutterNoiseBank() {}
+
+    // use caller owned arrays of voice_count entries: generator states, filter states and the output table
+    void init(uint32_t* state, float* low, float* band, float* noise, int voice_count)
+    {
+        _state = state;
+        _low = low;
+        _band = band;
+        _noise = noise;
+        _voice_count = voice_count;
+    }
+    // restarts every voice's stream from seed and clears filters and outputs, voices take streams from first_stream on
+    void reset(uint32_t seed, uint32_t first_stream = 0)
+    {
+        for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+        {
+            _state[voice_id] = noiseSeed(seed, first_stream + static_cast<uint32_t>(voice_id));
+            _low[voice_id] = 0.0f;
+            _band[voice_id] = 0.0f;
+            _noise[voice_id] = 0.0f;
+        }
+    }
+    // interval is the number of samples between calls to process, keeps filter states
+    void setRate(int sample_rate, int interval)
+    {
+        const float rate {static_cast<float>(sample_rate) / static_cast<float>(interval)};
+        // cutoffs near the update rate would make the filter unstable, limit it like daisysp::Svf does
+        _freq = 2.0f * std::sin(PI * std::min(CUTOFF / rate, 1.0f / 6.0f));
+        // output of a low pass fed with white noise grows with the square root of the decimation
+        _scale = GAIN / std::sqrt(static_cast<float>(interval));
+    }
+    // advances every voice one step and writes new noise to the table
+    void process()
+    {
+        int voice_id {0};
+#if DELAY_SIMD
+        const Float4 freq {Float4::set(_freq)};
+        const Float4 damp {Float4::set(DAMP)};
+        const Float4 scale {Float4::set(_scale)};
+        for (; voice_id + Float4::WIDTH <= _voice_count; voice_id += Float4::WIDTH)
+        {
+            const Float4 in {xorshiftNoise(_state + voice_id)};
+            const Float4 band {Float4::load(_band + voice_id)};
+            const Float4 low {Float4::load(_low + voice_id) + freq * band};
+            const Float4 high {in - low - damp * band};
+            low.store(_low + voice_id);
+            (band + freq * high).store(_band + voice_id);
+            (low * scale).store(_noise + voice_id);
+        }
+#endif
+        // same steps one voice at a time, so results don't depend on DELAY_SIMD
+        for (; voice_id < _voice_count; voice_id++)
+        {
+            const float in {xorshiftNoise(_state[voice_id])};
+            const float band {_band[voice_id]};
+            const float low {_low[voice_id] + _freq * band};
+            const float high {in - low - DAMP * band};
+            _low[voice_id] = low;
+            _band[voice_id] = band + _freq * high;
+            _noise[voice_id] = low * _scale;
+        }
+    }
+    // returns a voice's noise from the last process call
+    float get(int voice_id) const {return _noise[voice_id];}
+
+private:
+    static constexpr float PI{3.14159265358979323846f};
+    static constexpr float CUTOFF{200.0f};      //> low pass cutoff in Hz
+    static constexpr float DAMP{0.3182072f};    //> resonance of daisysp::Svf's default, 2 * (1 - 0.5^0.25)
+    static constexpr float GAIN{0.7f};          //> keeps flutter depth the pedal was tuned with on daisysp noise
+
+    uint32_t* _state{};     //> xorshift32 state of each voice
+    float* _low{};          //> low pass state of each voice
+    float* _band{};         //> band pass state of each voice
+    float* _noise{};        //> output table, one entry per voice
+    int _voice_count{};
+    float _freq{};          //> filter coefficient for CUTOFF at the update rate
+    float _scale{1.0f};     //> keeps output level equal to noise filtered every sample
+};
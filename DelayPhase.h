@@ -3,10 +3,11 @@
 
 #include "daisysp.h"
 #include "daisy_seed.h"
+#include "DelayRing.h"
 
-struct DelayVoice
+struct PhaseVoice
 {
-    DelayVoice()
+    PhaseVoice()
     :_bypass{false},
     _rptr{0.0f},
     _ratio{1.0f},
@@ -22,27 +23,34 @@ struct DelayVoice
     float _pan{}; //> 0.0 is left and 1.0 is right
     float _level{};
     float _feedback{}; //> currently not used
-    //float* _dline{};
+    int _written{}; //> samples written since the voice was added, older parts of its line hold a previous voice
 };
 
 
-template <int MAX_DELAY, int SAMPLE_RATE>
+// Voices live in a fixed pool, each pool slot owns one MAX_DELAY line of the buffer.
+// Adding and deleting voices is O(1) and never allocates, so it is safe between process calls on the audio thread.
+// voice_id is the slot returned by addVoice and stays valid until that voice is deleted.
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES = 8>
 class DelayPhase
 {
 public:
+    // samples the buffer passed to init needs for every slot to be usable
+    static constexpr int BUFFER_SIZE{MAX_DELAY * MAX_VOICES};
+
     DelayPhase();
-    ~DelayPhase() {delete[] _voices;}
+    ~DelayPhase() {}
     
     // adds new sample to delay line
     void process(float in);
-    // initializes delayline
+    // initializes delayline, slots whose line doesn't fit in size can't be used
     void init(float* buffer, int size);
     // returns sample in left buffer
     float getLeft() const {return _lbuff;}
     //returns sample in right buffer
     float getRight() const {return _rbuff;}
-    // add new voice to delay
-    void addVoice();
+    // add new voice to delay, returns its voice_id or -1 if every slot is in use
+    int addVoice();
+    // removes voice, its slot is reused by a later addVoice
     void deleteVoice(int voice_id);
 
     // set master delay time as ratio of MAX_DELAY - range: 0.0f - 1.0f
@@ -57,12 +65,15 @@ public:
         setDelayTime(voice_id,_voices[voice_id]._ratio * _master_delay);
     }
     void setPan(int voice_id, float pan) {_voices[voice_id]._pan = pan;}
-    void setGlobalLevel(float f) {for (int i{0}; i < _voice_count; i++) {_voices[i]._level = f;}}
+    void setGlobalLevel(float f) {for (int n{0}; n < _voice_count; n++) {_voices[_active[n]]._level = f;}}
     void setLevel(int voice_id, float lvl) {_voices[voice_id]._level = lvl;}
     // bool activates voice, false deactivates
     void setBypass(int voice_id, bool bypass) {_voices[voice_id]._bypass = bypass;}
     // system level getters
     int getVoiceCount() const {return _voice_count;}
+    // returns voice_id of the nth active voice, n in range 0 to getVoiceCount() - 1
+    int getVoiceId(int n) const {return _active[n];}
+    int getMaxVoices() const {return _slot_count;}
     float getMasterDelayTimeInMS() const {return (_master_delay / SAMPLE_RATE) * 1000.0f;}
     float getFlutter() const {return _flutter;}
     float getGlobalFeedback() const {return _master_feedback;}
@@ -73,10 +84,15 @@ public:
     float getLevel(int voice_id) const {return _voices[voice_id]._level;}
 
 private:
-    int _voice_count{};
-    float* _dline_mem; //> to replace _dline. delay line buffer stored in sdram
+    int _voice_count{}; //> number of active voices
+    float* _dline_mem{}; //> delay line buffer stored in sdram, slot lines are MAX_DELAY apart
     float* _wptr{}; //> write pointer
-    DelayVoice* _voices{};
+    PhaseVoice _voices[MAX_VOICES]{};
+    int _active[MAX_VOICES]{}; //> voice_ids of active voices, walked by process
+    int _active_index[MAX_VOICES]{}; //> position of each active voice in _active
+    int _free[MAX_VOICES]{}; //> stack of unused voice_ids
+    int _free_count{};
+    int _slot_count{}; //> slots whose line fits in the buffer
 
     float _master_delay{}; //> master delay time in samples that voice delay ratio is based on 
     float _master_feedback{};
@@ -91,32 +107,33 @@ private:
     // set delay time per voice
     void setDelayTime(int voice_id, float samples);
 
-    // reads sample from delay line at specific position and interpolates
-    float readSample(float position);
+    // true when MAX_DELAY lets delay lines wrap with a mask
+    static constexpr bool POWER_OF_TWO{(MAX_DELAY & (MAX_DELAY - 1)) == 0};
+
+    // reads sample from a voice's delay line at specific position and interpolates
+    float readSample(const float* dline, float position);
     // returns low pass filtered noise value
     float getLPNoise();
     // randomizes delay values to create a flutter effect
     void setFlutter();
 };
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-DelayPhase<MAX_DELAY, SAMPLE_RATE>::DelayPhase()
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::DelayPhase()
 :_voice_count{0},
-//_wptr{_dline},
-_voices{new DelayVoice[_voice_count]},
 _master_delay{1000.0f},
 _master_feedback{0.3f},
 _flutter{0.5f} 
 {
-    setMasterDelay(_master_delay);
+    // there are no voices or delay line yet, voices take their delay time from _master_delay when added
     // init dsp effects
     _noise.Init();
     _filter.Init(SAMPLE_RATE);
     _filter.SetFreq(200.0f);
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-void DelayPhase<MAX_DELAY,SAMPLE_RATE>::process(float in)
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+void DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::process(float in)
 {
     // apply some randomness to delays
     setFlutter();
@@ -125,8 +142,9 @@ void DelayPhase<MAX_DELAY,SAMPLE_RATE>::process(float in)
     _rbuff = 0.0f;
 
     // read next sample from delay line
-    for (int i{0}; i < _voice_count; i++)
+    for (int n{0}; n < _voice_count; n++)
     {
+        const int i {_active[n]};
         // Get current delay time
         float curr_delay {static_cast<float>(_wptr - _dline_mem) - _voices[i]._rptr};
         // enforce positive delay
@@ -139,11 +157,15 @@ void DelayPhase<MAX_DELAY,SAMPLE_RATE>::process(float in)
         else {interp_amnt = _voices[i]._inter_amnt;}
 
         // read value and interpolate if necassary to lengthen or shorten delay
-        const float read_sample{readSample(_voices[i]._rptr + interp_amnt + MAX_DELAY * i)};
+        // parts of the line written before the voice was added belong to the slot's previous voice
+        const float read_sample{static_cast<float>(_voices[i]._written) > curr_delay
+            ? readSample(_dline_mem + MAX_DELAY * i, _voices[i]._rptr + interp_amnt)
+            : 0.0f};
+        if (_voices[i]._written < MAX_DELAY) {_voices[i]._written++;}
         // increment read pointer
         _voices[i]._rptr += 1 + interp_amnt;
         // keep read pointer in range
-        if (static_cast<int>(std::floor(_voices[i]._rptr)) >= MAX_DELAY) {_voices[i]._rptr -= static_cast<float>(MAX_DELAY);}
+        if (_voices[i]._rptr >= static_cast<float>(MAX_DELAY)) {_voices[i]._rptr -= static_cast<float>(MAX_DELAY);}
 
         // voice output
         const float left_out = (1.0f - _voices[i]._pan) * read_sample * _voices[i]._level;
@@ -165,8 +187,8 @@ void DelayPhase<MAX_DELAY,SAMPLE_RATE>::process(float in)
     if (++_wptr - _dline_mem >= MAX_DELAY) {_wptr -= MAX_DELAY;}
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-void DelayPhase<MAX_DELAY,SAMPLE_RATE>::init(float* buffer, int size)
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+void DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::init(float* buffer, int size)
 {
     _dline_mem = buffer;
 
@@ -176,46 +198,65 @@ void DelayPhase<MAX_DELAY,SAMPLE_RATE>::init(float* buffer, int size)
     }
 
     _wptr = _dline_mem;
+
+    // every slot whose line fits starts out free, popped in ascending order
+    _voice_count = 0;
+    _slot_count = std::min(MAX_VOICES, size / MAX_DELAY);
+    _free_count = _slot_count;
+    for (int n{0}; n < _slot_count; n++)
+    {
+        _free[n] = _slot_count - 1 - n;
+    }
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-void DelayPhase<MAX_DELAY,SAMPLE_RATE>::addVoice()
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+int DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::addVoice()
 {
-    DelayVoice* new_arr {new DelayVoice[++_voice_count]};
-    memcpy(new_arr,_voices,(_voice_count - 1) * sizeof(DelayVoice));
-    //for (int i{0}; i < _voice_count - 1; i++) {new_arr[i] = _voices[i];}
-
-    delete[] _voices;
-    _voices = new_arr;
+    if (_free_count == 0) {return -1;}
+    const int voice_id {_free[--_free_count]};
+    _active_index[voice_id] = _voice_count;
+    _active[_voice_count++] = voice_id;
+
+    // reset slot, read pointer starts at the target delay so the voice doesn't slew in
+    _voices[voice_id] = PhaseVoice{};
+    _voices[voice_id]._rptr = static_cast<float>(_wptr - _dline_mem);
+    setDelayTime(voice_id, _voices[voice_id]._ratio * _master_delay);
+    _voices[voice_id]._rptr -= _voices[voice_id]._delay_time;
+    if (_voices[voice_id]._rptr < 0.0f) {_voices[voice_id]._rptr += static_cast<float>(MAX_DELAY);}
+    _voices[voice_id]._inter_amnt = 0.0f;
+
+    return voice_id;
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-void DelayPhase<MAX_DELAY, SAMPLE_RATE>::deleteVoice(int voice_id)
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+void DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::deleteVoice(int voice_id)
 {
-    DelayVoice* new_arr {new DelayVoice[std::max(--_voice_count,0)]};
-    memcpy(new_arr, _voices  ,voice_id * sizeof(DelayVoice));
-    if (voice_id < _voice_count) {memcpy(new_arr + voice_id, _voices + voice_id + 1, (_voice_count - (voice_id + 1)) * sizeof(DelayVoice));}
-    //for (int i{0}; i < voice_id; i++) {new_arr[i] = _voices[i];}
-    //for (int i{voice_id + 1}; i < _voice_count; i++) {new_arr[i] = _voices[i];}
-
-    delete[] _voices;
-    _voices = new_arr;
+    // ignore ids that aren't active
+    if (voice_id < 0 || voice_id >= _slot_count) {return;}
+    const int index {_active_index[voice_id]};
+    if (index >= _voice_count || _active[index] != voice_id) {return;}
+
+    // move last active voice into the gap so the active list stays dense
+    const int last {_active[--_voice_count]};
+    _active[index] = last;
+    _active_index[last] = index;
+    _free[_free_count++] = voice_id;
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-void DelayPhase<MAX_DELAY, SAMPLE_RATE>::setMasterDelay(float time)
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+void DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::setMasterDelay(float time)
 {
     _master_delay = time * static_cast<float>(MAX_DELAY);
     if (_master_delay < static_cast<float>(_voice_count)) {_master_delay = static_cast<float>(_voice_count);}
 
-    for (int i{0}; i < _voice_count; i++)
+    for (int n{0}; n < _voice_count; n++)
     {
-        setDelayTime(i,_voices[i]._ratio * _master_delay);
+        setDelayTime(_active[n],_voices[_active[n]]._ratio * _master_delay);
     }
 } 
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-void DelayPhase<MAX_DELAY,SAMPLE_RATE>::setDelayTime(int voice_id, float samples)
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+void DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::setDelayTime(int voice_id, float samples)
 {
     if (samples >= static_cast<float>(MAX_DELAY)) {samples = static_cast<float>(MAX_DELAY) - 1.0f;}
     else if (samples < 0.01f) {samples = 0.01f;}
@@ -230,9 +271,11 @@ void DelayPhase<MAX_DELAY,SAMPLE_RATE>::setDelayTime(int voice_id, float samples
     _voices[voice_id]._inter_amnt = delay_diff / static_cast<float>(SAMPLE_RATE);
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-float DelayPhase<MAX_DELAY,SAMPLE_RATE>::readSample(float position)
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+float DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::readSample(const float* dline, float position)
 {
+    if (POWER_OF_TWO) {return ringRead(dline, MAX_DELAY - 1, position);}
+
     float interp_amnt{position - std::floor(position)};
     int samp1{static_cast<int>(std::floor(position))};
     int samp2{samp1 + 1};
@@ -245,25 +288,26 @@ float DelayPhase<MAX_DELAY,SAMPLE_RATE>::readSample(float position)
     if (interp_amnt < (1.0f / static_cast<float>(MAX_DELAY))) { interp_amnt = 0.0f;}
     else if (interp_amnt > (static_cast<float>(MAX_DELAY - 1) / static_cast<float>(MAX_DELAY))) {interp_amnt = 1.0f;}
 
-    return (1.0f - interp_amnt) * _dline_mem[samp1] + interp_amnt * _dline_mem[samp2];
+    return (1.0f - interp_amnt) * dline[samp1] + interp_amnt * dline[samp2];
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-float DelayPhase<MAX_DELAY, SAMPLE_RATE>::getLPNoise()
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+float DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::getLPNoise()
 {
     const float noise_out{_noise.Process()};
     _filter.Process(noise_out);
     return _filter.Low();
 }
 
-template <int MAX_DELAY, int SAMPLE_RATE>
-void DelayPhase<MAX_DELAY,SAMPLE_RATE>::setFlutter()
+template <int MAX_DELAY, int SAMPLE_RATE, int MAX_VOICES>
+void DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>::setFlutter()
 {
     static constexpr float DELAY_SCALAR{10.0f};
     static constexpr float LEVEL_SCALAR{0.05f};
 
-    for (int i{0}; i < _voice_count; i++)
+    for (int n{0}; n < _voice_count; n++)
     {   
+        const int i {_active[n]};
         // randomizing delay time slightly causes pleasent random pitch shifting
         float noise {getLPNoise()};
         setDelayTime(i,_voices[i]._delay_time + _flutter * DELAY_SCALAR * noise);
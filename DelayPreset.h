@@ -0,0 +1,57 @@
+#pragma once
+
+#include "DelayControls.h"
+
+#include <type_traits>
+
+// Every DelayEngine parameter of one scene in a flat struct, so presets live in fixed arrays and copy as bytes.
+// Voice parameters are held for the first MAX_VOICES voices, further voices only follow the master values.
+struct DelayPreset
+{
+    static constexpr int MAX_VOICES{DelayControls::MAX_BYPASS_VOICES};
+
+    DelayControls controls{};       //> master values, ping pong and bypass
+    float ratio[MAX_VOICES]{};      //> delay ratio of each voice in range 0.0f to 1.0f
+    float pan[MAX_VOICES]{};        //> pan of each voice in range 0.0f to 1.0f
+    float detune[MAX_VOICES]{};     //> detune of each voice in samples
+};
+
+static_assert(std::is_trivially_copyable<DelayPreset>::value, "presets must copy as bytes");
+
+// recall or morph handed from the control thread to the audio thread
+struct DelayPresetRequest
+{
+    const DelayPreset* from{};
+    const DelayPreset* to{};
+    int blocks{};               //> sub-blocks the morph takes
+    uint32_t id{};              //> counts requests, a new id starts a new morph
+};
+
+// everything an engine's control thread hands over, controls and preset travel together so neither overtakes the other
+struct DelayHandoff
+{
+    DelayControls controls{};
+    DelayPresetRequest preset{};
+};
+
+// returns sub-blocks a morph over frames takes, at least one
+inline int presetBlocks(int frames, int block_frames) {return frames > block_frames ? (frames + block_frames - 1) / block_frames : 1;}
+// returns a moved towards b by amount in range 0.0f to 1.0f, exactly a and b at the ends
+inline float presetMix(float a, float b, float amount) {return a * (1.0f - amount) + b * amount;}
+
+// Preallocated presets, the engine recalls them by pointer so a slot must not be written while the engine morphs from or to it.
+template <int SIZE>
+class DelayPresetBank
+{
+public:
+    DelayPresetBank() {}
+
+    // returns preset in slot or nullptr if slot is out of range
+    DelayPreset* get(int slot) {return slot >= 0 && slot < SIZE ? &_presets[slot] : nullptr;}
+    const DelayPreset* get(int slot) const {return slot >= 0 && slot < SIZE ? &_presets[slot] : nullptr;}
+    // returns number of slots
+    static constexpr int getSize() {return SIZE;}
+
+private:
+    DelayPreset _presets[SIZE]{};
+};
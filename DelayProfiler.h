@@ -0,0 +1,230 @@
+#pragma once
+
+#include "TripleBuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Per stage timing of the audio path with min/mean/max and a load histogram.
+// A stage's time is summed over each audio block, so stats and load bins are per block however often the stage runs in it.
+// Build with DELAY_PROFILE=1 to enable, otherwise the DELAY_PROFILE_ macros expand to nothing and no timer code is compiled.
+// Times are taken from the DWT cycle counter on ARM and steady_clock in nanoseconds on the host.
+
+#ifndef DELAY_PROFILE
+#define DELAY_PROFILE 0
+#endif
+
+#if DELAY_PROFILE && !defined(__arm__)
+#include <chrono>
+#endif
+
+#if defined(__arm__)
+extern "C" uint32_t SystemCoreClock;    //> cpu clock in Hz, set by the CMSIS system init
+#endif
+
+// timed parts of the audio path, scopes nest so CALLBACK includes every other stage
+enum class ProfileStage
+{
+    CALLBACK,       //> whole audio callback
+    DELAY,          //> delay engine
+    CHORUS,         //> chorus engine
+    KERNEL,         //> voice block kernels, includes MODULATION and INTERPOLATION
+    MODULATION,     //> control rate flutter and pan update
+    INTERPOLATION,  //> delay line reads, timed around every read so its timer overhead adds to KERNEL
+    COUNT
+};
+
+// returns short lower case name of stage for reports
+inline const char* profileStageName(ProfileStage stage)
+{
+    static const char* const names[] {"callback", "delay", "chorus", "kernel", "modulation", "interpolation"};
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(ProfileStage::COUNT), "every stage needs a name");
+    return names[static_cast<int>(stage)];
+}
+
+// timing of one stage over a report window, ticks are cpu cycles on ARM and nanoseconds on the host
+struct ProfileStats
+{
+    static constexpr int LOAD_BINS{11};     //> 10% wide bins of block budget, the last counts overruns
+
+    uint32_t min{};
+    uint32_t max{};
+    uint64_t total{};
+    uint32_t count{};                       //> number of blocks the stage ran in
+    uint32_t load[LOAD_BINS]{};             //> blocks by share of the block's time budget
+
+    float mean() const {return count > 0 ? static_cast<float>(total) / static_cast<float>(count) : 0.0f;}
+};
+
+// stats of every stage, handed to the main loop at the end of each report window
+struct ProfileReport
+{
+    ProfileStats stages[static_cast<int>(ProfileStage::COUNT)]{};
+    float budget{};     //> ticks available per audio block
+    float tick_rate{};  //> ticks per second
+
+    const ProfileStats& stage(ProfileStage s) const {return stages[static_cast<int>(s)];}
+};
+
+class DelayProfiler
+{
+public:
+    DelayProfiler() {}
+
+    // starts the tick counter and sets the time budget of one block, report_blocks is the window length in blocks
+    void init(float sample_rate, size_t block_size, int report_blocks)
+    {
+        startClock();
+        _window = {};
+        _window.tick_rate = tickRate();
+        _window.budget = _window.tick_rate * static_cast<float>(block_size) / sample_rate;
+        _report_blocks = report_blocks;
+        _blocks = 0;
+        resetWindow();
+        resetBlock();
+    }
+    // adds ticks to the time of stage in the current block, called by ProfileScope
+    void add(ProfileStage stage, uint32_t ticks)
+    {
+        _block_ticks[static_cast<int>(stage)] += ticks;
+        _block_ran[static_cast<int>(stage)] = true;
+    }
+    // call once per audio block on the audio thread, records each stage's time in the block
+    // and publishes a report every report_blocks blocks
+    void endBlock()
+    {
+        for (int stage{0}; stage < static_cast<int>(ProfileStage::COUNT); stage++)
+        {
+            if (_block_ran[stage]) {record(static_cast<ProfileStage>(stage), _block_ticks[stage]);}
+        }
+        resetBlock();
+        if (++_blocks < _report_blocks) {return;}
+        _reports.write() = _window;
+        _reports.publish();
+        _blocks = 0;
+        resetWindow();
+    }
+    // main loop side, returns true if a new report was published since the last call
+    bool update() {return _reports.update();}
+    // latest report taken by update
+    const ProfileReport& read() const {return _reports.read();}
+
+    // returns current tick count, wraps so only differences are meaningful
+    static uint32_t ticks()
+    {
+#if defined(__arm__)
+        return debugRegister(DWT_CYCCNT_ADDRESS);
+#elif DELAY_PROFILE
+        using Clock = std::chrono::steady_clock;
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+#else
+        return 0;
+#endif
+    }
+
+private:
+#if defined(__arm__)
+    // Cortex-M debug registers that drive the cycle counter
+    static constexpr uintptr_t DEMCR_ADDRESS{0xE000EDFC};
+    static constexpr uintptr_t DWT_CTRL_ADDRESS{0xE0001000};
+    static constexpr uintptr_t DWT_CYCCNT_ADDRESS{0xE0001004};
+    static constexpr uintptr_t DWT_LAR_ADDRESS{0xE0001FB0};
+
+    static volatile uint32_t& debugRegister(uintptr_t address) {return *reinterpret_cast<volatile uint32_t*>(address);}
+#endif
+
+    ProfileReport _window{};                //> stats of the window being timed
+    TripleBuffer<ProfileReport> _reports{};
+    int _report_blocks{1};
+    int _blocks{};
+    uint32_t _block_ticks[static_cast<int>(ProfileStage::COUNT)]{};    //> time of each stage in the current block
+    bool _block_ran[static_cast<int>(ProfileStage::COUNT)]{};          //> true if the stage ran in the current block
+
+    // adds one block's time of stage to the window
+    void record(ProfileStage stage, uint32_t ticks)
+    {
+        ProfileStats& stats {_window.stages[static_cast<int>(stage)]};
+        if (stats.count == 0 || ticks < stats.min) {stats.min = ticks;}
+        if (ticks > stats.max) {stats.max = ticks;}
+        stats.total += ticks;
+        stats.count++;
+        int bin {_window.budget > 0.0f ? static_cast<int>(static_cast<float>(ticks) * 10.0f / _window.budget) : 0};
+        if (bin >= ProfileStats::LOAD_BINS) {bin = ProfileStats::LOAD_BINS - 1;}
+        stats.load[bin]++;
+    }
+    void resetWindow()
+    {
+        for (ProfileStats& stats : _window.stages) {stats = {};}
+    }
+    void resetBlock()
+    {
+        for (int stage{0}; stage < static_cast<int>(ProfileStage::COUNT); stage++)
+        {
+            _block_ticks[stage] = 0;
+            _block_ran[stage] = false;
+        }
+    }
+    static void startClock()
+    {
+#if defined(__arm__)
+        debugRegister(DEMCR_ADDRESS) |= 1u << 24;      //> enable trace
+        debugRegister(DWT_LAR_ADDRESS) = 0xC5ACCE55;   //> unlock DWT on M7
+        debugRegister(DWT_CYCCNT_ADDRESS) = 0;
+        debugRegister(DWT_CTRL_ADDRESS) |= 1u;         //> start cycle counter
+#endif
+    }
+    static float tickRate()
+    {
+#if defined(__arm__)
+        return static_cast<float>(SystemCoreClock);
+#else
+        return 1.0e9f;
+#endif
+    }
+};
+
+// profiler shared by every stage
+inline DelayProfiler& delayProfiler()
+{
+    static DelayProfiler profiler{};
+    return profiler;
+}
+
+// times the enclosing scope as stage
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileStage stage) : _stage{stage}, _start{DelayProfiler::ticks()} {}
+    ~ProfileScope() {delayProfiler().add(_stage, DelayProfiler::ticks() - _start);}
+
+private:
+    ProfileStage _stage{};
+    uint32_t _start{};
+};
+
+// times the enclosing scope as one audio block and ends the block, so reports are published from the audio thread
+class ProfileBlockScope
+{
+public:
+    ProfileBlockScope() : _start{DelayProfiler::ticks()} {}
+    ~ProfileBlockScope()
+    {
+        delayProfiler().add(ProfileStage::CALLBACK, DelayProfiler::ticks() - _start);
+        delayProfiler().endBlock();
+    }
+
+private:
+    uint32_t _start{};
+};
+
+#if DELAY_PROFILE
+#define DELAY_PROFILE_CONCAT_(a, b) a##b
+#define DELAY_PROFILE_CONCAT(a, b) DELAY_PROFILE_CONCAT_(a, b)
+// times the rest of the enclosing scope as ProfileStage::stage
+#define DELAY_PROFILE_SCOPE(stage) ProfileScope DELAY_PROFILE_CONCAT(profile_scope_, __LINE__){ProfileStage::stage}
+// times the rest of the enclosing scope as a CALLBACK, place first in the audio callback
+#define DELAY_PROFILE_BLOCK() ProfileBlockScope DELAY_PROFILE_CONCAT(profile_block_, __LINE__){}
+#else
+#define DELAY_PROFILE_SCOPE(stage)
+#define DELAY_PROFILE_BLOCK()
+#endif
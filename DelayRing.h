@@ -0,0 +1,135 @@
+#pragma once
+
+#include "DelaySample.h"
+
+// Helpers for delay lines whose size is a power of two, so positions wrap with a mask instead of compares
+
+// how a delay line is sized and indexed
+enum class RingMode
+{
+    EXACT,          //> line is exactly max delay long and wraps with compares
+    POWER_OF_TWO    //> line is rounded up to a power of two and wraps with a mask
+};
+
+// returns smallest power of two >= size
+constexpr int ringCapacity(int size)
+{
+    int capacity{1};
+    while (capacity < size) {capacity <<= 1;}
+    return capacity;
+}
+
+// returns line size used for max_delay in given mode -- allocate at least this many samples per voice
+constexpr int ringSize(int max_delay, RingMode mode)
+{
+    return mode == RingMode::POWER_OF_TWO ? ringCapacity(max_delay) : max_delay;
+}
+
+// extra samples kept past a voice's longest delay so flutter can't read beyond the end of a shortened line
+static constexpr int RATIO_HEADROOM{64};
+
+// returns delay in samples a voice needs when its delay time never exceeds max_ratio of max_delay
+constexpr int ratioDelay(int max_delay, float max_ratio)
+{
+    return max_ratio >= 1.0f ? max_delay : std::min(max_delay, static_cast<int>(static_cast<float>(max_delay) * std::max(0.0f, max_ratio)) + RATIO_HEADROOM);
+}
+
+// samples each line is padded to, so consecutive lines start on a cache line for both float and Q15 samples
+static constexpr int LINE_ALIGNMENT{16};
+
+// returns distance in samples from the start of a line to the start of the next one
+constexpr int lineStride(int line_size)
+{
+    return (line_size + LINE_ALIGNMENT - 1) / LINE_ALIGNMENT * LINE_ALIGNMENT;
+}
+
+// returns floor of position without a call or branch, truncation rounds negatives up so step back one
+inline int ringFloor(float position)
+{
+    return static_cast<int>(position) - static_cast<int>(position < 0.0f);
+}
+
+// returns linearly interpolated sample at position in a power of two line, position may be negative or past the end
+template <typename Sample>
+inline float ringRead(const Sample* dline, int mask, float position)
+{
+    const int index {ringFloor(position)};
+    const float interp_amnt {position - static_cast<float>(index)};
+    const float samp1 {SampleCodec<Sample>::decode(dline[index & mask])};
+    const float samp2 {SampleCodec<Sample>::decode(dline[(index + 1) & mask])};
+    return samp1 + interp_amnt * (samp2 - samp1);
+}
+
+// how fractional positions between samples are read from a power of two line
+enum class Interpolation
+{
+    NEAREST,    //> closest sample, cheapest but steps audibly while the read speed changes
+    LINEAR,     //> straight line between the two neighbouring samples
+    HERMITE,    //> 4 point cubic, keeps more high end on modulated reads
+    ALLPASS     //> first order allpass, flat magnitude but needs per channel history
+};
+
+// reader for each interpolation mode, history is the allpass output of the previous read and is unused by other modes
+template <Interpolation INTERP>
+struct RingReader;
+
+template <>
+struct RingReader<Interpolation::NEAREST>
+{
+    template <typename Sample>
+    static float read(const Sample* dline, int mask, float position, float&)
+    {
+        return SampleCodec<Sample>::decode(dline[ringFloor(position + 0.5f) & mask]);
+    }
+};
+
+template <>
+struct RingReader<Interpolation::LINEAR>
+{
+    template <typename Sample>
+    static float read(const Sample* dline, int mask, float position, float&) {return ringRead(dline, mask, position);}
+};
+
+template <>
+struct RingReader<Interpolation::HERMITE>
+{
+    template <typename Sample>
+    static float read(const Sample* dline, int mask, float position, float&)
+    {
+        const int index {ringFloor(position)};
+        const float t {position - static_cast<float>(index)};
+        const float xm1 {SampleCodec<Sample>::decode(dline[(index - 1) & mask])};
+        const float x0 {SampleCodec<Sample>::decode(dline[index & mask])};
+        const float x1 {SampleCodec<Sample>::decode(dline[(index + 1) & mask])};
+        const float x2 {SampleCodec<Sample>::decode(dline[(index + 2) & mask])};
+        // catmull-rom coefficients
+        const float c1 {0.5f * (x1 - xm1)};
+        const float c2 {xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2};
+        const float c3 {0.5f * (x2 - xm1) + 1.5f * (x0 - x1)};
+        return ((c3 * t + c2) * t + c1) * t + x0;
+    }
+};
+
+template <>
+struct RingReader<Interpolation::ALLPASS>
+{
+    template <typename Sample>
+    static float read(const Sample* dline, int mask, float position, float& history)
+    {
+        // delay from the newer sample is kept between 0.618 and 1.618 so the coefficient stays small and the filter settles fast
+        const int newer {ringFloor(position + 0.618f) + 1};
+        const float delay {static_cast<float>(newer) - position};
+        const float coeff {(1.0f - delay) / (1.0f + delay)};
+        const float x1 {SampleCodec<Sample>::decode(dline[newer & mask])};
+        const float x0 {SampleCodec<Sample>::decode(dline[(newer - 1) & mask])};
+        history = coeff * (x1 - history) + x0;
+        return history;
+    }
+};
+
+// returns sample at position in a power of two line read with INTERP
+template <Interpolation INTERP, typename Sample>
+inline float ringRead(const Sample* dline, int mask, float position, float& history)
+{
+    return RingReader<INTERP>::read(dline, mask, position, history);
+}
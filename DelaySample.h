@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Storage formats for delay lines. Audio is always processed as float, samples are converted on write and read.
+
+// peak level below which audio counts as silent, about -100dB
+static constexpr float SILENCE_THRESHOLD{1.0e-5f};
+
+// returns x with values far below hearing set to zero so decaying feedback never reaches slow denormals
+inline float flushDenormal(float x) {return std::abs(x) < 1.0e-20f ? 0.0f : x;}
+
+// returns largest absolute sample of a stereo block
+inline float blockPeak(const float* left, const float* right, size_t size)
+{
+    float peak{0.0f};
+    for (size_t i{0}; i < size; i++)
+    {
+        peak = std::max(peak, std::max(std::abs(left[i]), std::abs(right[i])));
+    }
+    return peak;
+}
+// returns number of frames at the start of a stereo block that are below SILENCE_THRESHOLD
+inline size_t quietFrames(const float* left, const float* right, size_t size)
+{
+    size_t i{0};
+    while (i < size && std::abs(left[i]) < SILENCE_THRESHOLD && std::abs(right[i]) < SILENCE_THRESHOLD) {i++;}
+    return i;
+}
+
+// format of the samples stored in a delay line
+enum class SampleFormat
+{
+    FLOAT,  //> 32 bit float, no conversion
+    Q15     //> 16 bit fixed point, halves memory and memory traffic
+};
+
+// converts between float audio and the stored sample type
+template <typename Sample>
+struct SampleCodec;
+
+template <>
+struct SampleCodec<float>
+{
+    static constexpr SampleFormat FORMAT{SampleFormat::FLOAT};
+
+    static float decode(float sample) {return sample;}
+    static float encode(float x) {return flushDenormal(x);}
+};
+
+template <>
+struct SampleCodec<int16_t>
+{
+    static constexpr SampleFormat FORMAT{SampleFormat::Q15};
+    static constexpr float HEADROOM{2.0f};  //> stored range is -2.0f to 2.0f so feedback peaks saturate less often
+
+    static float decode(int16_t sample) {return static_cast<float>(sample) * (HEADROOM / 32768.0f);}
+    static int16_t encode(float x)
+    {
+        // scale, round to nearest and saturate
+        float scaled {x * (32768.0f / HEADROOM)};
+        scaled += scaled < 0.0f ? -0.5f : 0.5f;
+        scaled = std::max(-32768.0f, std::min(32767.0f, scaled));
+        return static_cast<int16_t>(scaled);
+    }
+};
+
+// returns size in bytes of one stored sample
+inline size_t sampleSize(SampleFormat format)
+{
+    return format == SampleFormat::Q15 ? sizeof(int16_t) : sizeof(float);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+// Four lane float vector used to process voices side by side.
+// Maps to NEON on ARM cores that have it and SSE2 on x86, otherwise DELAY_SIMD is 0 and callers use their scalar path.
+// Define DELAY_SIMD=0 to force the scalar path.
+
+#ifndef DELAY_SIMD
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__SSE2__)
+#define DELAY_SIMD 1
+#else
+#define DELAY_SIMD 0
+#endif
+#endif
+
+#include <cstdint>
+
+// converts a generator output to range -1.0f to 1.0f
+static constexpr float NOISE_SCALE{1.0f / 2147483648.0f};
+
+// steps a xorshift32 generator and returns its output scaled to range -1.0f to 1.0f
+// scalar twin of the vector version below, both give the same value for the same state
+inline float xorshiftNoise(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<float>(static_cast<int32_t>(state)) * NOISE_SCALE;
+}
+
+#if DELAY_SIMD
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DELAY_SIMD_NEON 1
+#else
+#include <emmintrin.h>
+#define DELAY_SIMD_SSE 1
+#endif
+
+struct Float4
+{
+    static constexpr int WIDTH{4};
+
+#if DELAY_SIMD_NEON
+    float32x4_t v;
+
+    static Float4 load(const float* p) {return {vld1q_f32(p)};}
+    static Float4 set(float f) {return {vdupq_n_f32(f)};}
+    void store(float* p) const {vst1q_f32(p, v);}
+#else
+    __m128 v;
+
+    static Float4 load(const float* p) {return {_mm_loadu_ps(p)};}
+    static Float4 set(float f) {return {_mm_set1_ps(f)};}
+    void store(float* p) const {_mm_storeu_ps(p, v);}
+#endif
+};
+
+#if DELAY_SIMD_NEON
+inline Float4 operator+(Float4 a, Float4 b) {return {vaddq_f32(a.v, b.v)};}
+inline Float4 operator-(Float4 a, Float4 b) {return {vsubq_f32(a.v, b.v)};}
+inline Float4 operator*(Float4 a, Float4 b) {return {vmulq_f32(a.v, b.v)};}
+
+// returns absolute value of each lane
+inline Float4 absolute(Float4 x) {return {vabsq_f32(x.v)};}
+// returns larger value of each lane pair
+inline Float4 maximum(Float4 a, Float4 b) {return {vmaxq_f32(a.v, b.v)};}
+
+// adds limit to lanes that are <= 0
+inline Float4 wrapPositive(Float4 x, Float4 limit)
+{
+    const uint32x4_t wrap {vcleq_f32(x.v, vdupq_n_f32(0.0f))};
+    return {vaddq_f32(x.v, vreinterpretq_f32_u32(vandq_u32(wrap, vreinterpretq_u32_f32(limit.v))))};
+}
+
+// subtracts limit from lanes that are >= limit
+inline Float4 wrapBelow(Float4 x, Float4 limit)
+{
+    const uint32x4_t wrap {vcgeq_f32(x.v, limit.v)};
+    return {vsubq_f32(x.v, vreinterpretq_f32_u32(vandq_u32(wrap, vreinterpretq_u32_f32(limit.v))))};
+}
+
+// writes floor of each lane to index and returns the fractional part
+inline Float4 splitFloor(Float4 x, int* index)
+{
+    int32x4_t whole {vcvtq_s32_f32(x.v)};
+    // truncation rounds negatives up, the compare mask is -1 in those lanes
+    whole = vaddq_s32(whole, vreinterpretq_s32_u32(vcltq_f32(x.v, vcvtq_f32_s32(whole))));
+    vst1q_s32(index, whole);
+    return {vsubq_f32(x.v, vcvtq_f32_s32(whole))};
+}
+
+// returns sum of all lanes
+inline float sumLanes(Float4 x)
+{
+    const float32x2_t half {vadd_f32(vget_low_f32(x.v), vget_high_f32(x.v))};
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+
+// steps four xorshift32 generators stored at state and returns their outputs scaled to range -1.0f to 1.0f
+inline Float4 xorshiftNoise(uint32_t* state)
+{
+    uint32x4_t x {vld1q_u32(state)};
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    x = veorq_u32(x, vshlq_n_u32(x, 5));
+    vst1q_u32(state, x);
+    return {vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(x)), NOISE_SCALE)};
+}
+#else
+inline Float4 operator+(Float4 a, Float4 b) {return {_mm_add_ps(a.v, b.v)};}
+inline Float4 operator-(Float4 a, Float4 b) {return {_mm_sub_ps(a.v, b.v)};}
+inline Float4 operator*(Float4 a, Float4 b) {return {_mm_mul_ps(a.v, b.v)};}
+
+// returns absolute value of each lane
+inline Float4 absolute(Float4 x) {return {_mm_andnot_ps(_mm_set1_ps(-0.0f), x.v)};}
+// returns larger value of each lane pair
+inline Float4 maximum(Float4 a, Float4 b) {return {_mm_max_ps(a.v, b.v)};}
+
+// adds limit to lanes that are <= 0
+inline Float4 wrapPositive(Float4 x, Float4 limit)
+{
+    return {_mm_add_ps(x.v, _mm_and_ps(_mm_cmple_ps(x.v, _mm_setzero_ps()), limit.v))};
+}
+
+// subtracts limit from lanes that are >= limit
+inline Float4 wrapBelow(Float4 x, Float4 limit)
+{
+    return {_mm_sub_ps(x.v, _mm_and_ps(_mm_cmpge_ps(x.v, limit.v), limit.v))};
+}
+
+// writes floor of each lane to index and returns the fractional part
+inline Float4 splitFloor(Float4 x, int* index)
+{
+    __m128i whole {_mm_cvttps_epi32(x.v)};
+    // truncation rounds negatives up, the compare mask is -1 in those lanes
+    whole = _mm_add_epi32(whole, _mm_castps_si128(_mm_cmplt_ps(x.v, _mm_cvtepi32_ps(whole))));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(index), whole);
+    return {_mm_sub_ps(x.v, _mm_cvtepi32_ps(whole))};
+}
+
+// returns sum of all lanes
+inline float sumLanes(Float4 x)
+{
+    const __m128 high {_mm_movehl_ps(x.v, x.v)};
+    const __m128 half {_mm_add_ps(x.v, high)};
+    return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+}
+
+// steps four xorshift32 generators stored at state and returns their outputs scaled to range -1.0f to 1.0f
+inline Float4 xorshiftNoise(uint32_t* state)
+{
+    __m128i x {_mm_loadu_si128(reinterpret_cast<const __m128i*>(state))};
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), x);
+    return {_mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(NOISE_SCALE))};
+}
+#endif
+
+#endif
@@ -1,85 +1,204 @@
 #include "DelayVoice.h"
 
-void DelayVoice::init(float* l_buffer, float* r_buffer, int buffer_size, int sample_rate)
+#include <cstring>
+
+int DelayVoice::initLines(void* l_buffer, void* r_buffer, SampleFormat format, int buffer_size, int sample_rate, RingMode ring_mode)
 {
     _l_dline = l_buffer;
     _r_dline = r_buffer;
-    _max_delay = buffer_size;
+    _format = format;
+    _ring_mode = ring_mode;
+    _max_delay = ringSize(buffer_size, ring_mode);
+    _mask = _max_delay - 1;
+    _snap_low = 1.0f / static_cast<float>(_max_delay);
+    _snap_high = static_cast<float>(_max_delay - 1) / static_cast<float>(_max_delay);
     _sample_rate = sample_rate;
-    // zero out delay line
-    for (int i{0}; i < buffer_size; i++)
-    {
-        _l_dline[i] = 0.0f;
-        _r_dline[i] = 0.0f;
-    }
+    // zero out delay line, zero is all bits clear in every sample format
+    std::memset(_l_dline, 0, _max_delay * sampleSize(_format));
+    std::memset(_r_dline, 0, _max_delay * sampleSize(_format));
     // set write pointer to beginning of delay line
-    _l_wptr = _l_dline;
-    _r_wptr = _r_dline;
+    _wptr = 0;
     // init dsp objects
-    _noise.Init();
-    _filter.Init(_sample_rate);
-    _filter.SetFreq(200.0f);    //> set cutoff point for low pass filter at 200Hz
-    // init sin osc for ping pong mode
-    const float rate {0.6f + getLPNoise() * 0.5f};
-    _sin_osc.Init(_sample_rate);
-    _sin_osc.SetFreq(rate);
+    _noise_bank.init(&_noise_state, &_noise_low, &_noise_band, &_noise, 1);
+    _noise_bank.setRate(_sample_rate, _control_interval);
+    _noise_bank.reset(_noise_seed, _noise_stream);
+    _control_countdown = 0;
+    _flutter_offset = 0.0f;
+    _flutter_step = 0.0f;
+    _left_history = 0.0f;
+    _right_history = 0.0f;
+    _left_gain = 1.0f;
+    _right_gain = 1.0f;
+    _left_step = 0.0f;
+    _right_step = 0.0f;
+    _sleeping = false;
+    _quiet_samples = 0;
+    _peak = 0.0f;
+    _sub_block_frames = 0;
+    _sub_block_start = false;
+    // init lfo for ping pong mode, one noise step gives each voice its own rate
+    _noise_bank.process();
+    const float rate {0.6f + _noise_bank.get(0) * 0.5f};
+    _pan_lfo.init(_sample_rate, _control_interval);
+    _pan_lfo.setFreq(rate);
+
+    return _max_delay;
 }
 
 void DelayVoice::process(float left, float right)
 {
-    // process flutter
-    processFlutter();
-    
-    // clear buffers
-    _lbuff = 0.0f;
-    _rbuff = 0.0f;
-
-    // calculate current delay based on read and write pointer positions
-    float current_delay {static_cast<float>(_l_wptr - _l_dline) - _rptr};
-    if (current_delay <= 0.0f) {current_delay += static_cast<float>(_max_delay);}   //> enforce positive delay
-    // get difference from expected delay and use that value to adjust interpolation amount
-    const float delay_diff {current_delay - _delay_time + _detune};
-    float current_interp{(delay_diff * 1.25f) / static_cast<float>(_sample_rate)};
-    if (isinf(current_interp)) {current_interp = 0.0f;}
-    
-    // read sample from delay line
-    float left_dline_sample {readSample(_l_dline, _rptr + current_interp)};
-    float right_dline_sample {readSample(_r_dline, _rptr + current_interp)};
-    // increment read pointer
-    _rptr += 1 + current_interp;
-    // ensure read pointer in range
-    if (static_cast<int>(std::floor(_rptr)) >= _max_delay) {_rptr -= static_cast<float>(_max_delay);}
-
-    // get pan dependent on ping pong mode
-    float current_pan{_pan};
-    if (_ping_pong_mode) {current_pan = _sin_osc.Process() + 0.5f;}
-    // if not in ping pong mode, still run osc
-    else {_sin_osc.Process();}
-
-    // set buffers according to pan
-    if (current_pan < 0.5f)
+    float left_out{0.0f};
+    float right_out{0.0f};
+    process(&left, &right, &left_out, &right_out, 1);
+}
+
+void DelayVoice::process(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    const size_t asleep {prepareSleep(in_left, in_right, size)};
+    if (asleep > 0)
+    {
+        // the line holds only silence or is frozen by bypass, so just move the positions as if the frames ran
+        const int block {static_cast<int>(asleep)};
+        _wptr = _ring_mode == RingMode::POWER_OF_TWO ? (_wptr + block) & _mask : (_wptr + block) % _max_delay;
+        _rptr += static_cast<float>(block);
+        while (_rptr >= static_cast<float>(_max_delay)) {_rptr -= static_cast<float>(_max_delay);}
+        _lbuff = 0.0f;
+        _rbuff = 0.0f;
+        if (asleep == size) {return;}
+        // input woke the voice, run the rest of the block
+        in_left += asleep;
+        in_right += asleep;
+        out_left += asleep;
+        out_right += asleep;
+        size -= asleep;
+    }
+    DELAY_PROFILE_SCOPE(KERNEL);
+    if (_format == SampleFormat::Q15) {processFormat<int16_t>(in_left, in_right, out_left, out_right, size);}
+    else {processFormat<float>(in_left, in_right, out_left, out_right, size);}
+}
+
+size_t DelayVoice::prepareSleep(const float* in_left, const float* in_right, size_t size)
+{
+    if (!_sleep) {return 0;}
+
+    if (_sub_block_start)
     {
-        _lbuff = left_dline_sample;
-        _rbuff = current_pan * 2.0f * right_dline_sample;
+        _sub_block_start = false;
+        // count the last sub-block's writes, a voice that slept through it keeps its count
+        if (!_sleeping) {_quiet_samples = _peak < SILENCE_THRESHOLD ? std::min(_quiet_samples + _sub_block_frames, _max_delay) : 0;}
+        _peak = 0.0f;
+        _sub_block_frames = 0;
+        // a line has decayed once every sample in it was written below the threshold, a bypassed voice's line is frozen
+        _sleeping = _bypass || _quiet_samples >= _max_delay;
     }
-    else if (current_pan > 0.5f)
+    _sub_block_frames += static_cast<int>(size);
+    if (!_sleeping) {return 0;}
+    if (_bypass) {return size;}
+
+    // input is written to the line, so its first sound wakes the voice
+    const size_t quiet {quietFrames(in_left, in_right, size)};
+    if (quiet < size)
     {
-        _lbuff = (1.0f - current_pan) * 2.0f * left_dline_sample;
-        _rbuff = right_dline_sample;
+        _sleeping = false;
+        _quiet_samples = 0;
     }
-    else
+    return quiet;
+}
+
+template <typename Sample>
+void DelayVoice::processFormat(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    if (_ring_mode != RingMode::POWER_OF_TWO)
     {
-        _lbuff = left_dline_sample;
-        _rbuff = right_dline_sample;
+        processBlock<false, Interpolation::LINEAR, Sample>(in_left, in_right, out_left, out_right, size);
+        return;
     }
+    switch (_interpolation)
+    {
+    case Interpolation::NEAREST:
+        processBlock<true, Interpolation::NEAREST, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    case Interpolation::HERMITE:
+        processBlock<true, Interpolation::HERMITE, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    case Interpolation::ALLPASS:
+        processBlock<true, Interpolation::ALLPASS, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    default:
+        processBlock<true, Interpolation::LINEAR, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    }
+}
 
-    // write new left sample to left delay line
-    *_l_wptr = left + _lbuff * _feedback;
-    *_r_wptr = right + _rbuff * _feedback;
+template <bool POWER_OF_TWO, Interpolation INTERP, typename Sample>
+void DelayVoice::processBlock(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    // keep per voice state in locals for the duration of the block
+    Sample* const l_dline {static_cast<Sample*>(_l_dline)};
+    Sample* const r_dline {static_cast<Sample*>(_r_dline)};
+    const float max_delay {static_cast<float>(_max_delay)};
+    const float interp_scalar {_sample_rate > 0 ? 1.25f / static_cast<float>(_sample_rate) : 0.0f};
+    const float out_gain {_bypass ? 0.0f : 1.0f};   //> bypassed voices only run with sleep off, their delay line stays current then
+    int wptr {_wptr};
+    float rptr {_rptr};
+    float left_buff {_lbuff};
+    float right_buff {_rbuff};
+    float peak {0.0f};  //> largest sample written, used to detect a decayed line
 
-    // increment write pointer and keep in range
-    if (++_l_wptr - _l_dline >= _max_delay) {_l_wptr -= _max_delay;}
-    if (++_r_wptr - _r_dline >= _max_delay) {_r_wptr -= _max_delay;}
+    for (size_t i{0}; i < size; i++)
+    {
+        // process flutter and pan
+        processModulation();
+
+        // calculate current delay based on read and write pointer positions
+        float current_delay {static_cast<float>(wptr) - rptr};
+        if (current_delay <= 0.0f) {current_delay += max_delay;}   //> enforce positive delay
+        // get difference from expected delay and use that value to adjust interpolation amount
+        const float delay_diff {current_delay - _delay_time + _detune};
+        const float current_interp {delay_diff * interp_scalar};
+
+        // read sample from delay line
+        float left_dline_sample{};
+        float right_dline_sample{};
+        {
+            DELAY_PROFILE_SCOPE(INTERPOLATION);
+            left_dline_sample = POWER_OF_TWO
+                ? ringRead<INTERP>(l_dline, _mask, rptr + current_interp, _left_history)
+                : readSample(l_dline, rptr + current_interp);
+            right_dline_sample = POWER_OF_TWO
+                ? ringRead<INTERP>(r_dline, _mask, rptr + current_interp, _right_history)
+                : readSample(r_dline, rptr + current_interp);
+        }
+        // increment read pointer
+        rptr += 1 + current_interp;
+        // ensure read pointer in range
+        if (POWER_OF_TWO) {rptr -= rptr >= max_delay ? max_delay : 0.0f;}
+        else if (static_cast<int>(std::floor(rptr)) >= _max_delay) {rptr -= max_delay;}
+
+        // set buffers according to pan
+        left_buff = _left_gain * left_dline_sample;
+        right_buff = _right_gain * right_dline_sample;
+        out_left[i] += left_buff * out_gain;
+        out_right[i] += right_buff * out_gain;
+
+        // write new samples to delay lines
+        const float left_write {in_left[i] + left_buff * _feedback};
+        const float right_write {in_right[i] + right_buff * _feedback};
+        l_dline[wptr] = SampleCodec<Sample>::encode(left_write);
+        r_dline[wptr] = SampleCodec<Sample>::encode(right_write);
+        peak = std::max(peak, std::max(std::abs(left_write), std::abs(right_write)));
+
+        // increment write pointer and keep in range
+        if (POWER_OF_TWO) {wptr = (wptr + 1) & _mask;}
+        else if (++wptr >= _max_delay) {wptr = 0;}
+    }
+
+    // store state for next block
+    _wptr = wptr;
+    _rptr = rptr;
+    _lbuff = left_buff;
+    _rbuff = right_buff;
+    _peak = std::max(_peak, peak);
 }
 
 void DelayVoice::setDelayTime(float samples)
@@ -100,14 +219,19 @@ void DelayVoice::setFeedback(float feedback)
 }
 
 void DelayVoice::setPan(float pan)
+{
+    movePan(pan);
+
+    // adjust phase of ping pong lfo based on _pan
+    _pan_lfo.phaseAdd(_pan * 0.5f);
+}
+
+void DelayVoice::movePan(float pan)
 {
     if (pan < 0.0f) {pan = 0.0f;}
     else if (pan > 1.0f) {pan = 1.0f;}
 
     _pan = pan;
-
-    // adjust phase of ping pong osc based on _pan
-    _sin_osc.PhaseAdd(_pan * 0.5f);
 }
 
 void DelayVoice::setFlutter(float flutter)
@@ -118,7 +242,25 @@ void DelayVoice::setFlutter(float flutter)
     _flutter = flutter;
 }
 
-float DelayVoice::readSample(float* const dline, float position)
+void DelayVoice::setControlInterval(int samples)
+{
+    if (samples < 1) {samples = 1;}
+    _control_interval = samples;
+    _control_countdown = 0;
+    _noise_bank.setRate(_sample_rate, _control_interval);
+    _noise_bank.reset(_noise_seed, _noise_stream);
+    _pan_lfo.setInterval(_control_interval);
+}
+
+void DelayVoice::setSeed(uint32_t seed, uint32_t stream)
+{
+    _noise_seed = seed;
+    _noise_stream = stream;
+    _noise_bank.reset(_noise_seed, _noise_stream);
+}
+
+template <typename Sample>
+float DelayVoice::readSample(const Sample* dline, float position) const
 {
     // get samples to be interpolated
     float interp_amnt{position - std::floor(position)};
@@ -130,27 +272,37 @@ float DelayVoice::readSample(float* const dline, float position)
     if (samp2 < 0) {samp2 += _max_delay;}
     else if (samp2 >= _max_delay) {samp2 -= _max_delay;}
     // if interp amount is very large or very small than round
-    if (interp_amnt < (1.0f / static_cast<float>(_max_delay))) { interp_amnt = 0.0f;}
-    else if (interp_amnt > (static_cast<float>(_max_delay - 1) / static_cast<float>(_max_delay))) {interp_amnt = 1.0f;}
+    if (interp_amnt < _snap_low) { interp_amnt = 0.0f;}
+    else if (interp_amnt > _snap_high) {interp_amnt = 1.0f;}
 
-    return (1.0f - interp_amnt) * dline[samp1] + interp_amnt * dline[samp2];
+    return (1.0f - interp_amnt) * SampleCodec<Sample>::decode(dline[samp1]) + interp_amnt * SampleCodec<Sample>::decode(dline[samp2]);
 }
 
-void DelayVoice::processFlutter()
+void DelayVoice::processModulation()
 {
     static constexpr float DELAY_SCALAR{10.0f};
-    static constexpr float LEVEL_SCALAR{0.07f}; 
+    // flutter noise and pan move slowly so they are only taken at control rate and ramped in between
+    if (--_control_countdown <= 0) {updateModulation();}
+    _flutter_offset += _flutter_step;
     // randomizing delay time slightly causes pleasent random pitch shifting
-    float noise {getLPNoise()};
-    setDelayTime(_delay_time + _flutter * DELAY_SCALAR * noise);
-    // randomize delay volume
-    noise = std::abs(getLPNoise());
-    _level = 1.0f - (noise * _flutter * LEVEL_SCALAR);
+    setDelayTime(_delay_time + _flutter * DELAY_SCALAR * _flutter_offset);
+    _left_gain += _left_step;
+    _right_gain += _right_step;
 }
 
-float DelayVoice::getLPNoise()
+void DelayVoice::updateModulation()
 {
-    const float noise_out{_noise.Process()};
-    _filter.Process(noise_out);
-    return _filter.Low();
-}
\ No newline at end of file
+    DELAY_PROFILE_SCOPE(MODULATION);
+    const float step_scalar {1.0f / static_cast<float>(_control_interval)};
+    _control_countdown = _control_interval;
+
+    _noise_bank.process();
+    const float noise {_noise_bank.get(0)};
+    _flutter_step = (noise - _flutter_offset) * step_scalar;
+
+    // get pan dependent on ping pong mode, lfo always runs to keep its phase so switching modes ramps smoothly
+    const float lfo_pan {_pan_lfo.process()};
+    const float pan {_ping_pong_mode ? lfo_pan : _pan};
+    _left_step = (panLeftGain(pan) - _left_gain) * step_scalar;
+    _right_step = (panRightGain(pan) - _right_gain) * step_scalar;
+}
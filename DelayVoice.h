@@ -1,7 +1,10 @@
 #pragma once
 
-#include "Synthesis/oscillator.h"
 #include "daisysp.h"
+#include "DelayModulation.h"
+#include "DelayNoise.h"
+#include "DelayProfiler.h"
+#include "DelayRing.h"
 
 class DelayVoice
 {
@@ -11,13 +14,11 @@ public:
     _r_dline{nullptr},
     _max_delay{0},
     _sample_rate{48000},
-    _l_wptr{nullptr},
-    _r_wptr{nullptr},
+    _wptr{0},
     _rptr{0.0f},
     _lbuff{0.0f},
     _rbuff{0.0f},
     _delay_time{0.0f},
-    _level{1.0f},
     _feedback{0.0f},
     _pan{0.5f},
     _flutter{0.0f},
@@ -27,12 +28,19 @@ public:
 
     ~DelayVoice() {}
 
-    // max delay is half of buffer size
-    void init(float* l_buffer, float* r_buffer, int buffer_size, int sample_rate);
+    // inits delay lines and returns max delay in samples, buffers may be float or int16_t (Q15)
+    // POWER_OF_TWO mode needs buffers of ringCapacity(buffer_size)
+    template <typename Sample>
+    int init(Sample* l_buffer, Sample* r_buffer, int buffer_size, int sample_rate, RingMode ring_mode = RingMode::EXACT)
+    {
+        return initLines(l_buffer, r_buffer, SampleCodec<Sample>::FORMAT, buffer_size, sample_rate, ring_mode);
+    }
     // input new stereo sample
     void process(float left, float right);
     // input new mono sample
     void process(float in) {process(in * 0.5f, in * 0.5f);}
+    // process a block of stereo samples, voice output is added to out buffers unless bypassed -- out buffers must not alias in buffers
+    void process(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
     
     // set member values
     // set delay time in samples (samples can be fractional)
@@ -41,14 +49,28 @@ public:
     void setFeedback(float feedback);
     // set pan: 0.0f = left, 1.0f = right
     void setPan(float pan);
+    // set pan without offsetting the ping pong lfo, for pans that change while audio runs
+    void movePan(float pan);
     // set flutter amount from range 0.0f to 1.0f
     void setFlutter(float flutter);
-    // set bypass to true or false
+    // set bypass to true or false, while sleep is on a bypassed voice skips processing from the next sub-block
+    // and its line is frozen until it returns
     void setBypass(bool b) {_bypass = b;}
     // set ping_pong_mode
     void setPingPongMode(bool b) {_ping_pong_mode = b;}
     // set detune amount in samples to stretch
     void setDetune(float detune) {_detune = detune;}
+    // set samples between flutter and pan updates, resets modulators so call before audio starts
+    void setControlInterval(int samples);
+    // set how POWER_OF_TWO lines are read between samples, EXACT lines are always read linearly
+    void setInterpolation(Interpolation interpolation) {_interpolation = interpolation;}
+    // let the voice skip processing once its line has decayed to silence or it is bypassed, on by default
+    void setSleep(bool b) {_sleep = b; _sleeping = false; _quiet_samples = 0; _peak = 0.0f; _sub_block_frames = 0;}
+    // marks the start of a sub-block, the voice only falls asleep there so the host block size doesn't change when it does
+    void startSubBlock() {_sub_block_start = true;}
+    // set seed of the flutter noise and the stream of it the voice takes, restarts noise so call before audio starts
+    // voice n of an engine takes stream n, the noise voice n of a DelayVoiceBank gets from the same seed
+    void setSeed(uint32_t seed, uint32_t stream = 0);
     
     // get buffer outputs
     float getRight() const {return _rbuff;}
@@ -62,40 +84,87 @@ public:
     float getPan() const {return _pan;}
     // returns flutter
     float getFlutter() const {return _flutter;}
+    // returns detune in samples
+    float getDetune() const {return _detune;}
     // returns bypass state
     bool getBypass() const {return _bypass;}
+    // returns max delay in samples
+    int getMaxDelay() const {return _max_delay;}
+    // returns interpolation mode
+    Interpolation getInterpolation() const {return _interpolation;}
+    // returns true while the voice sleeps
+    bool getSleeping() const {return _sleeping;}
 
 private:
     // delay line members
-    float* _l_dline{};      //> left delay line
-    float* _r_dline{};      //> right delay line
+    void* _l_dline{};       //> left delay line, samples stored as _format
+    void* _r_dline{};       //> right delay line
+    SampleFormat _format{}; //> type of samples in delay lines
     int _max_delay{};       //> max delay size in samples
+    RingMode _ring_mode{};  //> how delay lines wrap
+    int _mask{};            //> _max_delay - 1 in POWER_OF_TWO mode
+    Interpolation _interpolation{Interpolation::LINEAR};
+    float _left_history{};  //> last left read, used by ALLPASS interpolation
+    float _right_history{};
+    float _snap_low{};      //> interpolation amounts below this are rounded down in EXACT mode
+    float _snap_high{};     //> interpolation amounts above this are rounded up in EXACT mode
     int _sample_rate{};     //> holds hardware sample rate
-    float* _l_wptr{};       //> left delay write pointer
-    float* _r_wptr{};       //> right delay line write pointer
+    int _wptr{};            //> delay line write position, shared by both channels
     float _rptr{};          //> fractional delay line read pointer
     // audio output members
     float _lbuff{};         //> left audio buffer
     float _rbuff{};         //> right audio buffer
     // parameter members
     float _delay_time{};    //> holds target delay time in samples
-    float _level{};         //> output level of delay voice
     float _feedback{};      //> delay feedback
     float _pan{};           //> 0.0f is left, 1.0f is right
     float _flutter{};       //> controls warping of delay line
     bool _bypass{};         //> stores bypass state to be used by wrapper
     bool _ping_pong_mode{}; //> true if voice is in ping pong mode
     float _detune{};        //> scalar value that detunes voice
+    // flutter members
+    int _control_interval{CONTROL_INTERVAL};    //> samples between flutter and pan updates
+    int _control_countdown{};                   //> samples left until the next flutter and pan update
+    float _flutter_offset{};                    //> flutter noise ramped between updates
+    float _flutter_step{};                      //> per sample change of _flutter_offset
+    float _left_gain{1.0f};                     //> pan gains for the current sample
+    float _right_gain{1.0f};
+    float _left_step{};                         //> per sample change of _left_gain
+    float _right_step{};
+    // sleep members
+    bool _sleep{true};          //> true when a decayed or bypassed voice may skip blocks
+    bool _sleeping{};           //> true while the voice skips frames
+    int _quiet_samples{};       //> samples since the voice last wrote above SILENCE_THRESHOLD, counted at sub-block starts
+    float _peak{};              //> largest sample written this sub-block
+    int _sub_block_frames{};    //> frames processed since the sub-block started
+    bool _sub_block_start{};    //> true until the first frames of a sub-block are processed
 
-    // daisy premade dsp objects
-    daisysp::WhiteNoise _noise{};
-    daisysp::Svf _filter{};
-    daisysp::Oscillator _sin_osc{};
+    // modulation sources
+    FlutterNoiseBank _noise_bank{};             //> bank of one voice over the members below
+    uint32_t _noise_state{};
+    float _noise_low{};
+    float _noise_band{};
+    float _noise{};
+    uint32_t _noise_seed{NOISE_SEED};
+    uint32_t _noise_stream{};
+    PanLfo _pan_lfo{};
 
-    // returns interpolated sample at position in _dline
-    float readSample(float* const dline, float position);
-    // randomly alters delay time to cause warping and adds some low freq noise
-    void processFlutter();
-    // returns low freq noise
-    float getLPNoise();
+    // stores delay lines and resets state, shared by all sample types
+    int initLines(void* l_buffer, void* r_buffer, SampleFormat format, int buffer_size, int sample_rate, RingMode ring_mode);
+    // at a sub-block start counts the last sub-block's quiet writes and puts a decayed or bypassed voice to sleep
+    // returns frames to skip, input wakes a voice that isn't bypassed at its first frame above the threshold
+    size_t prepareSleep(const float* in_left, const float* in_right, size_t size);
+    // picks the kernel for ring mode and interpolation
+    template <typename Sample>
+    void processFormat(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
+    // block processing kernel specialized on ring mode, interpolation and sample type
+    template <bool POWER_OF_TWO, Interpolation INTERP, typename Sample>
+    void processBlock(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
+    // returns interpolated sample at position in dline
+    template <typename Sample>
+    float readSample(const Sample* dline, float position) const;
+    // randomly alters delay time to cause warping and ramps pan gains
+    void processModulation();
+    // takes new flutter noise and pan and sets ramps towards them
+    void updateModulation();
 };
\ No newline at end of file
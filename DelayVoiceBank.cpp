@@ -0,0 +1,329 @@
+#include "DelayVoiceBank.h"
+
+#include <cstring>
+
+constexpr int DelayVoiceBank::PARAM_COUNT;
+constexpr int DelayVoiceBank::VECTOR_WIDTH;
+
+int DelayVoiceBank::initLines(void* l_buffer, void* r_buffer, SampleFormat format, int max_delay, int voice_count, int sample_rate, RingMode ring_mode, bool shared_line,
+    const float* max_ratios)
+{
+    _l_dline = l_buffer;
+    _r_dline = r_buffer;
+    _format = format;
+    _ring_mode = ring_mode;
+    _max_delay = ringSize(max_delay, ring_mode);
+    _mask = _max_delay - 1;
+    _snap_low = 1.0f / static_cast<float>(_max_delay);
+    _snap_high = static_cast<float>(_max_delay - 1) / static_cast<float>(_max_delay);
+    _sample_rate = sample_rate;
+    _interp_scalar = _sample_rate > 0 ? 1.25f / static_cast<float>(_sample_rate) : 0.0f;
+    _voice_count = voice_count;
+    _shared_line = shared_line;
+    _tap_scale = voice_count > 0 ? 1.0f / static_cast<float>(voice_count) : 1.0f;
+    _wptr = 0;
+    _control_countdown = 0;
+    // zero out delay lines, zero is all bits clear in every sample format
+    const int buffer_size {bufferSize(max_delay, voice_count, ring_mode, shared_line, max_ratios)};
+    std::memset(_l_dline, 0, buffer_size * sampleSize(_format));
+    std::memset(_r_dline, 0, buffer_size * sampleSize(_format));
+
+    // allocate parameters as one block so hot arrays share cache lines
+    if (_owns_storage)
+    {
+        delete[] _params;
+        delete[] _lines;
+        delete[] _mods;
+        _params = new float[voice_count * PARAM_COUNT];
+        _lines = new int[voice_count * LINE_PARAM_COUNT];
+        _mods = new VoiceModulators[voice_count];
+    }
+    _rptr = _params;
+    _delay_time = _rptr + voice_count;
+    _feedback = _delay_time + voice_count;
+    _detune = _feedback + voice_count;
+    _left_gain = _detune + voice_count;
+    _right_gain = _left_gain + voice_count;
+    _left_step = _right_gain + voice_count;
+    _right_step = _left_step + voice_count;
+    _left_history = _right_step + voice_count;
+    _right_history = _left_history + voice_count;
+    _out_gain = _right_history + voice_count;
+    _flutter_offset = _out_gain + voice_count;
+    _flutter_step = _flutter_offset + voice_count;
+    _peak = _flutter_step + voice_count;
+    _skip = _peak + voice_count;
+    _delay_limit = _skip + voice_count;
+    _pan = _delay_limit + voice_count;
+    _line_offset = _lines;
+    _line_mask = _line_offset + voice_count;
+    // generators step unsigned, int and uint32_t may share storage
+    _noise_state = reinterpret_cast<uint32_t*>(_line_mask + voice_count);
+    _flutter = _pan + voice_count;
+    _noise_low = _flutter + voice_count;
+    _noise_band = _noise_low + voice_count;
+    _noise = _noise_band + voice_count;
+    _noise_bank.init(_noise_state, _noise_low, _noise_band, _noise, voice_count);
+    _noise_bank.setRate(_sample_rate, _control_interval);
+    _noise_bank.reset(_noise_seed);
+    // take one step so each voice's ping pong lfo gets its own rate
+    _noise_bank.process();
+
+    int line_offset {0};
+    for (int voice_id{0}; voice_id < voice_count; voice_id++)
+    {
+        // lay out lines back to back, a shared line is used by every voice
+        const int line_size {voiceLineSize(max_delay, max_ratios != nullptr ? max_ratios[voice_id] : 1.0f, ring_mode, shared_line)};
+        _line_offset[voice_id] = line_offset;
+        _line_mask[voice_id] = line_size - 1;
+        _delay_limit[voice_id] = static_cast<float>(line_size) - 1.0f;
+        if (!_shared_line) {line_offset += lineStride(line_size);}
+
+        // read heads start one line behind the write position, a shortened line must not slew in from further back
+        _rptr[voice_id] = static_cast<float>(_max_delay - line_size);
+        _delay_time[voice_id] = 0.0f;
+        _feedback[voice_id] = 0.0f;
+        _detune[voice_id] = 0.0f;
+        _left_gain[voice_id] = 1.0f;
+        _right_gain[voice_id] = 1.0f;
+        _left_step[voice_id] = 0.0f;
+        _right_step[voice_id] = 0.0f;
+        _left_history[voice_id] = 0.0f;
+        _right_history[voice_id] = 0.0f;
+        _out_gain[voice_id] = 1.0f;
+        _flutter_offset[voice_id] = 0.0f;
+        _flutter_step[voice_id] = 0.0f;
+        _peak[voice_id] = 0.0f;
+        _skip[voice_id] = 0.0f;
+        _mods[voice_id].quiet_samples = 0;
+        _pan[voice_id] = 0.5f;
+        _flutter[voice_id] = 0.0f;
+        // init lfo for ping pong mode
+        const float rate {0.6f + _noise_bank.get(voice_id) * 0.5f};
+        _mods[voice_id].pan_lfo.init(_sample_rate, _control_interval);
+        _mods[voice_id].pan_lfo.setFreq(rate);
+    }
+    _ping_pong_mode = false;
+    _sub_block_start = false;
+    _sub_block_frames = 0;
+    _sleeping_voices = 0;
+    _frozen_voices = 0;
+
+    return _max_delay;
+}
+
+void DelayVoiceBank::process(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    if (_format == SampleFormat::Q15) {processFormat<int16_t>(in_left, in_right, out_left, out_right, size);}
+    else {processFormat<float>(in_left, in_right, out_left, out_right, size);}
+}
+
+template <typename Sample>
+void DelayVoiceBank::processFormat(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    if (_ring_mode == RingMode::POWER_OF_TWO)
+    {
+        if (_shared_line) {processInterpolated<true, Sample>(in_left, in_right, out_left, out_right, size);}
+        else {processInterpolated<false, Sample>(in_left, in_right, out_left, out_right, size);}
+    }
+    else
+    {
+        if (_shared_line) {processBlock<0, 0, 0, false, true, Interpolation::LINEAR, Sample>(in_left, in_right, out_left, out_right, size);}
+        else {processBlock<0, 0, 0, false, false, Interpolation::LINEAR, Sample>(in_left, in_right, out_left, out_right, size);}
+    }
+}
+
+template <bool SHARED, typename Sample>
+void DelayVoiceBank::processInterpolated(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    switch (_interpolation)
+    {
+    case Interpolation::NEAREST:
+        processBlock<0, 0, 0, true, SHARED, Interpolation::NEAREST, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    case Interpolation::HERMITE:
+        processBlock<0, 0, 0, true, SHARED, Interpolation::HERMITE, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    case Interpolation::ALLPASS:
+        processBlock<0, 0, 0, true, SHARED, Interpolation::ALLPASS, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    default:
+        processBlock<0, 0, 0, true, SHARED, Interpolation::LINEAR, Sample>(in_left, in_right, out_left, out_right, size);
+        break;
+    }
+}
+
+void DelayVoiceBank::setDelayTime(int voice_id, float samples)
+{
+    // ensure samples is in range of the voice's line
+    if (samples > _delay_limit[voice_id]) {samples = _delay_limit[voice_id];}
+    else if (samples < 0.01f) {samples = 0.01f;}
+
+    _delay_time[voice_id] = samples;
+}
+
+void DelayVoiceBank::setFeedback(int voice_id, float feedback)
+{
+    if (feedback < 0.0f) {feedback = 0.0f;}
+    else if (feedback > 1.0f) {feedback = 1.0f;}
+
+    _feedback[voice_id] = feedback;
+}
+
+void DelayVoiceBank::setPan(int voice_id, float pan)
+{
+    movePan(voice_id, pan);
+
+    // adjust phase of ping pong lfo based on pan
+    _mods[voice_id].pan_lfo.phaseAdd(_pan[voice_id] * 0.5f);
+}
+
+void DelayVoiceBank::movePan(int voice_id, float pan)
+{
+    if (pan < 0.0f) {pan = 0.0f;}
+    else if (pan > 1.0f) {pan = 1.0f;}
+
+    _pan[voice_id] = pan;
+}
+
+void DelayVoiceBank::setFlutter(int voice_id, float flutter)
+{
+    if (flutter < 0.0f) {flutter = 0.0f;}
+    else if (flutter > 1.0f) {flutter = 1.0f;}
+
+    _flutter[voice_id] = flutter;
+}
+
+void DelayVoiceBank::setControlInterval(int samples)
+{
+    if (samples < 1) {samples = 1;}
+    _control_interval = samples;
+    _control_countdown = 0;
+
+    _noise_bank.setRate(_sample_rate, _control_interval);
+    _noise_bank.reset(_noise_seed);
+    for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+    {
+        _mods[voice_id].pan_lfo.setInterval(_control_interval);
+    }
+}
+
+void DelayVoiceBank::setSleep(bool b)
+{
+    _sleep = b;
+    // waking restarts silence detection so a voice only sleeps after a full line of quiet writes
+    for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+    {
+        _skip[voice_id] = 0.0f;
+        _peak[voice_id] = 0.0f;
+        _mods[voice_id].quiet_samples = 0;
+    }
+    _sub_block_frames = 0;
+    _sleeping_voices = 0;
+    _frozen_voices = 0;
+}
+
+size_t DelayVoiceBank::prepareSleep(const float* in_left, const float* in_right, size_t size, int group_width)
+{
+    if (!_sleep) {return size;}
+
+    if (_sub_block_start)
+    {
+        _sub_block_start = false;
+        // count the last sub-block's writes, voices that slept through it keep their count
+        // a shared line is written while any tap runs, so bypassed taps count its writes too
+        for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+        {
+            const bool written {_shared_line ? _sleeping_voices < _voice_count : _skip[voice_id] == 0.0f};
+            if (!written) {continue;}
+            const float peak {_shared_line ? _peak[0] : _peak[voice_id]};
+            int& quiet {_mods[voice_id].quiet_samples};
+            quiet = peak < SILENCE_THRESHOLD ? std::min(quiet + _sub_block_frames, _line_mask[voice_id] + 1) : 0;
+        }
+        for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+        {
+            _peak[voice_id] = 0.0f;
+        }
+        _sub_block_frames = 0;
+
+        markSkipped(group_width, false);
+    }
+    if (_sleeping_voices == _frozen_voices) {return size;}
+
+    // input is written to every line, so its first sound wakes all voices that aren't bypassed
+    const size_t quiet {quietFrames(in_left, in_right, size)};
+    if (quiet > 0) {return quiet;}
+    for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+    {
+        if (_out_gain[voice_id] != 0.0f) {_mods[voice_id].quiet_samples = 0;}
+    }
+    markSkipped(group_width, true);
+    return size;
+}
+
+void DelayVoiceBank::markSkipped(int group_width, bool woken)
+{
+    // a line has decayed once every sample in it was written below the threshold
+    const int vector_count {_voice_count - _voice_count % group_width};
+    _sleeping_voices = 0;
+    _frozen_voices = 0;
+    for (int voice_id{0}; voice_id < _voice_count;)
+    {
+        const int width {voice_id < vector_count ? group_width : 1};
+        bool bypassed {true};
+        bool decayed {!woken};
+        for (int lane{0}; lane < width; lane++)
+        {
+            bypassed = bypassed && _out_gain[voice_id + lane] == 0.0f;
+            decayed = decayed && (_out_gain[voice_id + lane] == 0.0f || _mods[voice_id + lane].quiet_samples > _line_mask[voice_id + lane]);
+        }
+        const bool skip {bypassed || decayed};
+        for (int lane{0}; lane < width; lane++)
+        {
+            _skip[voice_id + lane] = skip ? 1.0f : 0.0f;
+        }
+        if (skip) {_sleeping_voices += width;}
+        if (bypassed) {_frozen_voices += width;}
+        voice_id += width;
+    }
+}
+
+void DelayVoiceBank::finishSleep(size_t size)
+{
+    if (!_sleep) {return;}
+
+    const int block {static_cast<int>(size)};
+    _sub_block_frames += block;
+    if (_sleeping_voices == 0) {return;}
+    const float max_delay {static_cast<float>(_max_delay)};
+    for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+    {
+        if (_skip[voice_id] == 0.0f) {continue;}
+        // keep the sleeping read head the same distance behind the write position
+        float rptr {_rptr[voice_id] + static_cast<float>(block)};
+        while (rptr >= max_delay) {rptr -= max_delay;}
+        _rptr[voice_id] = rptr;
+    }
+}
+
+void DelayVoiceBank::updateModulation()
+{
+    DELAY_PROFILE_SCOPE(MODULATION);
+    const float step_scalar {1.0f / static_cast<float>(_control_interval)};
+    _control_countdown = _control_interval;
+
+    // noise for every voice comes from one pass over the bank, voices only read their entry
+    _noise_bank.process();
+    for (int voice_id{0}; voice_id < _voice_count; voice_id++)
+    {
+        // ramp to the new noise value over the next interval
+        const float noise {_noise_bank.get(voice_id)};
+        _flutter_step[voice_id] = (noise - _flutter_offset[voice_id]) * step_scalar;
+
+        // get pan dependent on ping pong mode, lfo always runs to keep its phase so switching modes ramps smoothly
+        const float lfo_pan {_mods[voice_id].pan_lfo.process()};
+        const float pan {_ping_pong_mode ? lfo_pan : _pan[voice_id]};
+        _left_step[voice_id] = (panLeftGain(pan) - _left_gain[voice_id]) * step_scalar;
+        _right_step[voice_id] = (panRightGain(pan) - _right_gain[voice_id]) * step_scalar;
+    }
+}
@@ -0,0 +1,510 @@
+#pragma once
+
+#include "daisysp.h"
+#include "DelayModulation.h"
+#include "DelayNoise.h"
+#include "DelayProfiler.h"
+#include "DelayRing.h"
+#include "DelaySimd.h"
+
+// Stores a set of delay voices as parallel arrays that share one write position.
+// Each voice keeps its own delay line, but per sample work only touches the dense parameter arrays.
+// With a shared line every voice is a read head (tap) on one stereo line and their feedback is summed into a single write.
+// Bypassed taps are left out of that sum, so bypassing a voice silences its echoes in every layout.
+class DelayVoiceBank
+{
+public:
+    DelayVoiceBank() {}
+
+    ~DelayVoiceBank() { if (_owns_storage) {delete[] _params; delete[] _lines; delete[] _mods;}}
+    // parameter arrays are owned or lent by the caller, copies would share them
+    DelayVoiceBank(const DelayVoiceBank&) = delete;
+    DelayVoiceBank& operator=(const DelayVoiceBank&) = delete;
+
+    // number of float arrays carved from the parameter block
+    static constexpr int PARAM_COUNT{21};
+    // number of int arrays carved from the line block
+    static constexpr int LINE_PARAM_COUNT{3};
+
+    // per voice modulation sources, these are large so they are kept out of the hot arrays
+    struct VoiceModulators
+    {
+        PanLfo pan_lfo{};
+        int quiet_samples{};    //> samples since the voice last wrote above SILENCE_THRESHOLD
+    };
+
+    // use caller owned parameter storage instead of allocating in init, call before init
+    // params needs voice_count * PARAM_COUNT floats, lines voice_count * LINE_PARAM_COUNT ints and mods voice_count entries
+    void setStorage(float* params, int* lines, VoiceModulators* mods) {_params = params; _lines = lines; _mods = mods; _owns_storage = false;}
+
+    // returns samples in one voice's line, only separate POWER_OF_TWO lines can be shortened
+    // shortened lines still divide the longest one, so every voice can index with the shared write position
+    static constexpr int voiceLineSize(int max_delay, float max_ratio, RingMode ring_mode, bool shared_line)
+    {
+        return ring_mode == RingMode::POWER_OF_TWO && !shared_line ? ringSize(ratioDelay(max_delay, max_ratio), ring_mode) : ringSize(max_delay, ring_mode);
+    }
+    // returns samples needed in each buffer passed to init, max_ratios holds the largest delay ratio of each voice or nullptr for full lines
+    static constexpr int bufferSize(int max_delay, int voice_count, RingMode ring_mode, bool shared_line = false, const float* max_ratios = nullptr)
+    {
+        int size {0};
+        for (int voice_id{0}; voice_id < (shared_line ? 1 : voice_count); voice_id++)
+        {
+            size += lineStride(voiceLineSize(max_delay, max_ratios != nullptr ? max_ratios[voice_id] : 1.0f, ring_mode, shared_line));
+        }
+        return size;
+    }
+    // inits delay lines and returns max delay in samples, buffers may be float or int16_t (Q15)
+    // Ensure buffer size is >= bufferSize(max_delay, voice_count, ring_mode, shared_line, max_ratios)
+    // with max_ratios each voice's delay time is kept below its ratio of max_delay so its line can be shorter
+    template <typename Sample>
+    int init(Sample* l_buffer, Sample* r_buffer, int max_delay, int voice_count, int sample_rate, RingMode ring_mode = RingMode::EXACT, bool shared_line = false,
+        const float* max_ratios = nullptr)
+    {
+        return initLines(l_buffer, r_buffer, SampleCodec<Sample>::FORMAT, max_delay, voice_count, sample_rate, ring_mode, shared_line, max_ratios);
+    }
+    // process a block of stereo samples and write summed voice output -- out buffers must not alias in buffers
+    void process(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
+    // process with voice count, line size, sample rate and interpolation known at compile time so loops unroll and divisions fold
+    // must match the values passed to init in POWER_OF_TWO mode
+    template <int VOICES, int LINE_SIZE, int SAMPLE_RATE, Interpolation INTERP, typename Sample>
+    void processFixed(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+    {
+        processBlock<VOICES, LINE_SIZE, SAMPLE_RATE, true, false, INTERP, Sample>(in_left, in_right, out_left, out_right, size);
+    }
+
+    // set member values
+    // set delay time in samples (samples can be fractional)
+    void setDelayTime(int voice_id, float samples);
+    // set feedback in range 0.0f to 1.0f
+    void setFeedback(int voice_id, float feedback);
+    // set pan: 0.0f = left, 1.0f = right
+    void setPan(int voice_id, float pan);
+    // set pan without offsetting the ping pong lfo, for pans that change while audio runs
+    void movePan(int voice_id, float pan);
+    // set flutter amount from range 0.0f to 1.0f
+    void setFlutter(int voice_id, float flutter);
+    // set bypass to true or false, while sleep is on a bypassed voice skips processing and its line is frozen until it returns
+    // in groups of four only a fully bypassed group is skipped
+    void setBypass(int voice_id, bool b) {_out_gain[voice_id] = b ? 0.0f : 1.0f;}
+    // set ping pong mode for all voices
+    void setPingPongMode(bool b) {_ping_pong_mode = b;}
+    // set detune amount in samples to stretch
+    void setDetune(int voice_id, float detune) {_detune[voice_id] = detune;}
+    // set samples between flutter and pan updates for all voices, resets modulators so call before audio starts
+    void setControlInterval(int samples);
+    // set how POWER_OF_TWO lines are read between samples, EXACT lines are always read linearly
+    void setInterpolation(Interpolation interpolation) {_interpolation = interpolation;}
+    // let voices whose lines have decayed to silence skip processing until new input arrives, on by default
+    // turning it off runs bypassed voices too
+    void setSleep(bool b);
+    // marks the start of a sub-block, voices only fall asleep there so the host block size doesn't change when they do
+    void startSubBlock() {_sub_block_start = true;}
+    // set seed of the flutter noise, restarts noise so call before audio starts -- equal seeds give equal flutter
+    void setSeed(uint32_t seed) {_noise_seed = seed; _noise_bank.reset(seed);}
+
+    // get summed output of last processed sample
+    float getLeft() const {return _lbuff;}
+    float getRight() const {return _rbuff;}
+    // get member values
+    float getDelayTime(int voice_id) const {return _delay_time[voice_id];}
+    float getFeedback(int voice_id) const {return _feedback[voice_id];}
+    float getPan(int voice_id) const {return _pan[voice_id];}
+    float getFlutter(int voice_id) const {return _flutter[voice_id];}
+    float getDetune(int voice_id) const {return _detune[voice_id];}
+    bool getBypass(int voice_id) const {return _out_gain[voice_id] == 0.0f;}
+    int getVoiceCount() const {return _voice_count;}
+    int getMaxDelay() const {return _max_delay;}
+    // returns samples in the line of a voice, less than getMaxDelay for shortened lines
+    int getLineSize(int voice_id) const {return _line_mask[voice_id] + 1;}
+    bool getSharedLine() const {return _shared_line;}
+    Interpolation getInterpolation() const {return _interpolation;}
+    bool getSleep() const {return _sleep;}
+    uint32_t getSeed() const {return _noise_seed;}
+    // returns number of voices sleeping, bypassed voices that skip processing included
+    int getSleepingVoices() const {return _sleeping_voices;}
+
+private:
+    // delay line members
+    void* _l_dline{};           //> left delay lines, each voice's line starts at _line_offset
+    void* _r_dline{};           //> right delay lines
+    SampleFormat _format{};     //> type of samples in delay lines
+    int _max_delay{};           //> size of the longest voice's delay line in samples
+    RingMode _ring_mode{};      //> how delay lines wrap
+    int _mask{};                //> _max_delay - 1 in POWER_OF_TWO mode
+    float _snap_low{};          //> interpolation amounts below this are rounded down in EXACT mode
+    float _snap_high{};         //> interpolation amounts above this are rounded up in EXACT mode
+    int _sample_rate{};
+    int _voice_count{};
+    int _wptr{};                //> write position shared by all voices
+    float _interp_scalar{};     //> converts delay error in samples to read speed change
+    bool _shared_line{};        //> true when all voices read one delay line
+    float _tap_scale{};         //> scales summed feedback of a shared line, 1 / _voice_count
+    Interpolation _interpolation{Interpolation::LINEAR};
+    // audio output members
+    float _lbuff{};
+    float _rbuff{};
+    bool _ping_pong_mode{};
+    int _control_interval{CONTROL_INTERVAL};    //> samples between flutter and pan updates
+    int _control_countdown{};                   //> samples left until the next flutter and pan update
+    bool _sleep{true};                          //> true when decayed voices may skip blocks
+    bool _sub_block_start{};                    //> true until the first frames of a sub-block are processed
+    int _sub_block_frames{};                    //> frames processed since the sub-block started
+    int _sleeping_voices{};                     //> voices marked in _skip
+    int _frozen_voices{};                       //> voices marked in _skip because their whole group is bypassed, input doesn't wake them
+
+    // hot per voice parameters, each array is _voice_count long and carved from _params
+    float* _params{};
+    float* _rptr{};             //> fractional read position
+    float* _delay_time{};       //> target delay time in samples
+    float* _feedback{};
+    float* _detune{};
+    float* _left_gain{};        //> pan gains for the current sample
+    float* _right_gain{};
+    float* _left_step{};        //> per sample change of _left_gain
+    float* _right_step{};
+    float* _left_history{};     //> last left read, used by ALLPASS interpolation
+    float* _right_history{};
+    float* _out_gain{};         //> 0.0f when bypassed, 1.0f otherwise
+    float* _flutter_offset{};   //> flutter noise ramped between control rate updates
+    float* _flutter_step{};     //> per sample change of _flutter_offset
+    float* _peak{};             //> largest sample written this sub-block, only the first entry is used with a shared line
+    float* _skip{};             //> 1.0f while the voice sleeps
+    float* _delay_limit{};      //> longest delay time the voice's line can hold
+    // hot per voice line layout, carved from _lines
+    int* _lines{};
+    int* _line_offset{};        //> first sample of the voice's line in the buffers
+    int* _line_mask{};          //> line size - 1, lines are full length in EXACT mode
+    uint32_t* _noise_state{};   //> flutter noise generator states, stored in _lines
+    // cold per voice parameters
+    float* _pan{};
+    float* _flutter{};
+    float* _noise_low{};        //> flutter noise filter states
+    float* _noise_band{};
+    float* _noise{};            //> flutter noise table, refilled every control interval
+    VoiceModulators* _mods{};
+    // flutter noise for all voices, fills _noise
+    FlutterNoiseBank _noise_bank{};
+    uint32_t _noise_seed{NOISE_SEED};
+    bool _owns_storage{true};   //> false when storage was given with setStorage
+
+#if DELAY_SIMD
+    static constexpr int VECTOR_WIDTH{Float4::WIDTH};
+#else
+    static constexpr int VECTOR_WIDTH{1};
+#endif
+
+    // stores delay lines and resets state, shared by all sample types
+    int initLines(void* l_buffer, void* r_buffer, SampleFormat format, int max_delay, int voice_count, int sample_rate, RingMode ring_mode, bool shared_line,
+        const float* max_ratios);
+
+    // at a sub-block start counts the last sub-block's quiet writes and marks decayed voices in _skip
+    // voices processed in groups of group_width only sleep when the whole group has decayed
+    // returns frames the marks hold for, input wakes every voice that isn't bypassed at its first frame above the threshold
+    size_t prepareSleep(const float* in_left, const float* in_right, size_t size, int group_width);
+    // marks groups in _skip whose voices are all bypassed or, unless woken, decayed or bypassed
+    void markSkipped(int group_width, bool woken);
+    // moves sleeping read heads along with the write position and counts the frames of the sub-block
+    void finishSleep(size_t size);
+
+    // kernels below take voice count, line size and sample rate as template arguments, 0 uses the values from init
+
+    // picks the kernel for ring mode and line sharing chosen at init
+    template <typename Sample>
+    void processFormat(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
+    // picks the POWER_OF_TWO kernel for the interpolation mode
+    template <bool SHARED, typename Sample>
+    void processInterpolated(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
+    // block processing kernel specialized on sizes, ring mode, line sharing, interpolation and sample type
+    template <int VOICES, int LINE_SIZE, int SAMPLE_RATE, bool POWER_OF_TWO, bool SHARED, Interpolation INTERP, typename Sample>
+    void processBlock(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size);
+    // runs POWER_OF_TWO LINEAR kernel for voices in groups of four and adds to outputs, returns number of voices processed
+    // with a SHARED line voices don't write, their feedback is added to left_feedback and right_feedback instead
+    template <int VOICES, int LINE_SIZE, int SAMPLE_RATE, bool SHARED, typename Sample>
+    int processVectorVoices(float in_left, float in_right, float& left_out, float& right_out, float& left_feedback, float& right_feedback);
+    // advances flutter and pan gain ramps of every voice to the next sample
+    template <int VOICES>
+    void processModulation();
+    // takes new flutter noise and pan for every voice and sets ramps towards them
+    void updateModulation();
+    // returns interpolated sample at position in dline
+    template <typename Sample>
+    float readSample(const Sample* dline, float position) const;
+};
+
+template <int VOICES, int LINE_SIZE, int SAMPLE_RATE, bool POWER_OF_TWO, bool SHARED, Interpolation INTERP, typename Sample>
+void DelayVoiceBank::processBlock(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+{
+    // voices whose lines have decayed skip the block, input wakes them at its first loud frame wherever the host block starts
+    const bool vector_voices {DELAY_SIMD && POWER_OF_TWO && INTERP == Interpolation::LINEAR};
+    const size_t asleep {prepareSleep(in_left, in_right, size, vector_voices ? VECTOR_WIDTH : 1)};
+    if (asleep < size)
+    {
+        processBlock<VOICES, LINE_SIZE, SAMPLE_RATE, POWER_OF_TWO, SHARED, INTERP, Sample>(in_left, in_right, out_left, out_right, asleep);
+        processBlock<VOICES, LINE_SIZE, SAMPLE_RATE, POWER_OF_TWO, SHARED, INTERP, Sample>(in_left + asleep, in_right + asleep, out_left + asleep, out_right + asleep,
+            size - asleep);
+        return;
+    }
+
+    DELAY_PROFILE_SCOPE(KERNEL);
+    Sample* const l_dline {static_cast<Sample*>(_l_dline)};
+    Sample* const r_dline {static_cast<Sample*>(_r_dline)};
+    const int voice_count {VOICES > 0 ? VOICES : _voice_count};
+    const int line_size {LINE_SIZE > 0 ? LINE_SIZE : _max_delay};
+    const int mask {line_size - 1};
+    const float max_delay {static_cast<float>(line_size)};
+    const float interp_scalar {SAMPLE_RATE > 0 ? 1.25f / static_cast<float>(SAMPLE_RATE) : _interp_scalar};
+    const float tap_scale {VOICES > 0 ? 1.0f / static_cast<float>(VOICES) : _tap_scale};
+    float left_out{0.0f};
+    float right_out{0.0f};
+
+    // when every voice sleeps only the positions move
+    if (_sleeping_voices == voice_count)
+    {
+        for (size_t i{0}; i < size; i++)
+        {
+            out_left[i] = 0.0f;
+            out_right[i] = 0.0f;
+        }
+        _wptr = POWER_OF_TWO ? (_wptr + static_cast<int>(size)) & mask : (_wptr + static_cast<int>(size)) % line_size;
+        finishSleep(size);
+        _lbuff = 0.0f;
+        _rbuff = 0.0f;
+        return;
+    }
+
+    // samples are the outer loop so every voice sees the same write position
+    for (size_t i{0}; i < size; i++)
+    {
+        processModulation<VOICES>();
+
+        left_out = 0.0f;
+        right_out = 0.0f;
+        float left_feedback{0.0f};
+        float right_feedback{0.0f};
+        const float wptr {static_cast<float>(_wptr)};
+        // voices that don't fill a vector group run through the scalar kernel
+        int voice_id {POWER_OF_TWO && INTERP == Interpolation::LINEAR
+            ? processVectorVoices<VOICES, LINE_SIZE, SAMPLE_RATE, SHARED, Sample>(in_left[i], in_right[i], left_out, right_out, left_feedback, right_feedback)
+            : 0};
+        for (; voice_id < voice_count; voice_id++)
+        {
+            if (_skip[voice_id] != 0.0f) {continue;}
+            const int line_offset {SHARED ? 0 : _line_offset[voice_id]};
+            const int line_mask {SHARED ? mask : _line_mask[voice_id]};
+            // calculate current delay based on read and write positions
+            float current_delay {wptr - _rptr[voice_id]};
+            if (current_delay <= 0.0f) {current_delay += max_delay;}   //> enforce positive delay
+            // get difference from expected delay and use that value to adjust interpolation amount
+            const float delay_diff {current_delay - _delay_time[voice_id] + _detune[voice_id]};
+            const float current_interp {delay_diff * interp_scalar};
+
+            // read sample from delay line
+            const float position {_rptr[voice_id] + current_interp};
+            float left_sample{};
+            float right_sample{};
+            {
+                DELAY_PROFILE_SCOPE(INTERPOLATION);
+                left_sample = POWER_OF_TWO
+                    ? ringRead<INTERP>(l_dline + line_offset, line_mask, position, _left_history[voice_id])
+                    : readSample(l_dline + line_offset, position);
+                right_sample = POWER_OF_TWO
+                    ? ringRead<INTERP>(r_dline + line_offset, line_mask, position, _right_history[voice_id])
+                    : readSample(r_dline + line_offset, position);
+            }
+            const float left_buff {left_sample * _left_gain[voice_id]};
+            const float right_buff {right_sample * _right_gain[voice_id]};
+            // increment read pointer and keep in range
+            float rptr {_rptr[voice_id] + 1 + current_interp};
+            if (POWER_OF_TWO) {rptr -= rptr >= max_delay ? max_delay : 0.0f;}
+            else if (static_cast<int>(std::floor(rptr)) >= line_size) {rptr -= max_delay;}
+            _rptr[voice_id] = rptr;
+
+            left_out += left_buff * _out_gain[voice_id];
+            right_out += right_buff * _out_gain[voice_id];
+
+            // write new samples to delay lines, a shared line is written once after every tap has been read
+            // a bypassed tap must not feed the shared line, its echoes would come back through every other tap
+            if (SHARED)
+            {
+                left_feedback += left_buff * _feedback[voice_id] * _out_gain[voice_id];
+                right_feedback += right_buff * _feedback[voice_id] * _out_gain[voice_id];
+            }
+            else
+            {
+                const float left_write {in_left[i] + left_buff * _feedback[voice_id]};
+                const float right_write {in_right[i] + right_buff * _feedback[voice_id]};
+                // shortened lines wrap the shared write position with their own mask
+                const int write_index {line_offset + (POWER_OF_TWO ? _wptr & line_mask : _wptr)};
+                l_dline[write_index] = SampleCodec<Sample>::encode(left_write);
+                r_dline[write_index] = SampleCodec<Sample>::encode(right_write);
+                _peak[voice_id] = std::max(_peak[voice_id], std::max(std::abs(left_write), std::abs(right_write)));
+            }
+        }
+        if (SHARED)
+        {
+            const float left_write {in_left[i] + left_feedback * tap_scale};
+            const float right_write {in_right[i] + right_feedback * tap_scale};
+            l_dline[_wptr] = SampleCodec<Sample>::encode(left_write);
+            r_dline[_wptr] = SampleCodec<Sample>::encode(right_write);
+            _peak[0] = std::max(_peak[0], std::max(std::abs(left_write), std::abs(right_write)));
+        }
+        out_left[i] = left_out;
+        out_right[i] = right_out;
+
+        // increment shared write position and keep in range
+        if (POWER_OF_TWO) {_wptr = (_wptr + 1) & mask;}
+        else if (++_wptr >= line_size) {_wptr = 0;}
+    }
+
+    finishSleep(size);
+    _lbuff = left_out;
+    _rbuff = right_out;
+}
+
+template <int VOICES, int LINE_SIZE, int SAMPLE_RATE, bool SHARED, typename Sample>
+int DelayVoiceBank::processVectorVoices(float in_left, float in_right, float& left_out, float& right_out, float& left_feedback, float& right_feedback)
+{
+#if DELAY_SIMD
+    Sample* const l_dline {static_cast<Sample*>(_l_dline)};
+    Sample* const r_dline {static_cast<Sample*>(_r_dline)};
+    const int voice_count {VOICES > 0 ? VOICES : _voice_count};
+    const int line_size {LINE_SIZE > 0 ? LINE_SIZE : _max_delay};
+    const int mask {line_size - 1};
+    const int vector_count {voice_count - voice_count % Float4::WIDTH};
+    const Float4 max_delay {Float4::set(static_cast<float>(line_size))};
+    const Float4 wptr {Float4::set(static_cast<float>(_wptr))};
+    const Float4 interp_scalar {Float4::set(SAMPLE_RATE > 0 ? 1.25f / static_cast<float>(SAMPLE_RATE) : _interp_scalar)};
+    const Float4 one {Float4::set(1.0f)};
+    const Float4 left_in {Float4::set(in_left)};
+    const Float4 right_in {Float4::set(in_right)};
+    Float4 left_sum {Float4::set(0.0f)};
+    Float4 right_sum {Float4::set(0.0f)};
+    Float4 left_feedback_sum {Float4::set(0.0f)};
+    Float4 right_feedback_sum {Float4::set(0.0f)};
+
+    for (int voice_id{0}; voice_id < vector_count; voice_id += Float4::WIDTH)
+    {
+        // groups sleep together so checking the first lane is enough
+        if (_skip[voice_id] != 0.0f) {continue;}
+        // calculate current delay of each voice and adjust read speed towards target delay
+        const Float4 rptr {Float4::load(_rptr + voice_id)};
+        const Float4 current_delay {wrapPositive(wptr - rptr, max_delay)};
+        const Float4 delay_diff {current_delay - Float4::load(_delay_time + voice_id) + Float4::load(_detune + voice_id)};
+        const Float4 current_interp {delay_diff * interp_scalar};
+        // increment read pointers and keep in range
+        wrapBelow(rptr + one + current_interp, max_delay).store(_rptr + voice_id);
+
+        // read positions differ per voice so samples are gathered lane by lane
+        Float4 left_read {Float4::set(0.0f)};
+        Float4 right_read {Float4::set(0.0f)};
+        {
+            DELAY_PROFILE_SCOPE(INTERPOLATION);
+            int index[Float4::WIDTH];
+            const Float4 interp_amnt {splitFloor(rptr + current_interp, index)};
+            float left_samp1[Float4::WIDTH], left_samp2[Float4::WIDTH];
+            float right_samp1[Float4::WIDTH], right_samp2[Float4::WIDTH];
+            for (int lane{0}; lane < Float4::WIDTH; lane++)
+            {
+                const int line_offset {SHARED ? 0 : _line_offset[voice_id + lane]};
+                const int line_mask {SHARED ? mask : _line_mask[voice_id + lane]};
+                const int samp1 {line_offset + (index[lane] & line_mask)};
+                const int samp2 {line_offset + ((index[lane] + 1) & line_mask)};
+                left_samp1[lane] = SampleCodec<Sample>::decode(l_dline[samp1]);
+                left_samp2[lane] = SampleCodec<Sample>::decode(l_dline[samp2]);
+                right_samp1[lane] = SampleCodec<Sample>::decode(r_dline[samp1]);
+                right_samp2[lane] = SampleCodec<Sample>::decode(r_dline[samp2]);
+            }
+            const Float4 left_first {Float4::load(left_samp1)};
+            const Float4 right_first {Float4::load(right_samp1)};
+            left_read = left_first + interp_amnt * (Float4::load(left_samp2) - left_first);
+            right_read = right_first + interp_amnt * (Float4::load(right_samp2) - right_first);
+        }
+        const Float4 left_buff {left_read * Float4::load(_left_gain + voice_id)};
+        const Float4 right_buff {right_read * Float4::load(_right_gain + voice_id)};
+
+        const Float4 out_gain {Float4::load(_out_gain + voice_id)};
+        left_sum = left_sum + left_buff * out_gain;
+        right_sum = right_sum + right_buff * out_gain;
+
+        const Float4 feedback {Float4::load(_feedback + voice_id)};
+        if (SHARED)
+        {
+            // shared line is written once by the caller, bypassed taps don't feed it
+            left_feedback_sum = left_feedback_sum + left_buff * feedback * out_gain;
+            right_feedback_sum = right_feedback_sum + right_buff * feedback * out_gain;
+            continue;
+        }
+        // write new samples to delay lines, scattered lane by lane
+        float left_write[Float4::WIDTH], right_write[Float4::WIDTH];
+        const Float4 left_level {left_in + left_buff * feedback};
+        const Float4 right_level {right_in + right_buff * feedback};
+        left_level.store(left_write);
+        right_level.store(right_write);
+        maximum(Float4::load(_peak + voice_id), maximum(absolute(left_level), absolute(right_level))).store(_peak + voice_id);
+        for (int lane{0}; lane < Float4::WIDTH; lane++)
+        {
+            const int write_index {_line_offset[voice_id + lane] + (_wptr & _line_mask[voice_id + lane])};
+            l_dline[write_index] = SampleCodec<Sample>::encode(left_write[lane]);
+            r_dline[write_index] = SampleCodec<Sample>::encode(right_write[lane]);
+        }
+    }
+
+    left_out += sumLanes(left_sum);
+    right_out += sumLanes(right_sum);
+    if (SHARED)
+    {
+        left_feedback += sumLanes(left_feedback_sum);
+        right_feedback += sumLanes(right_feedback_sum);
+    }
+    return vector_count;
+#else
+    (void)in_left;
+    (void)in_right;
+    (void)left_out;
+    (void)right_out;
+    (void)left_feedback;
+    (void)right_feedback;
+    return 0;
+#endif
+}
+
+template <int VOICES>
+void DelayVoiceBank::processModulation()
+{
+    static constexpr float DELAY_SCALAR{10.0f};
+    const int voice_count {VOICES > 0 ? VOICES : _voice_count};
+
+    if (--_control_countdown <= 0) {updateModulation();}
+
+    for (int voice_id{0}; voice_id < voice_count; voice_id++)
+    {
+        // randomizing delay time slightly causes pleasent random pitch shifting, clamped the same as setDelayTime
+        _flutter_offset[voice_id] += _flutter_step[voice_id];
+        float delay_time {_delay_time[voice_id] + _flutter[voice_id] * DELAY_SCALAR * _flutter_offset[voice_id]};
+        if (delay_time > _delay_limit[voice_id]) {delay_time = _delay_limit[voice_id];}
+        else if (delay_time < 0.01f) {delay_time = 0.01f;}
+        _delay_time[voice_id] = delay_time;
+
+        _left_gain[voice_id] += _left_step[voice_id];
+        _right_gain[voice_id] += _right_step[voice_id];
+    }
+}
+
+template <typename Sample>
+float DelayVoiceBank::readSample(const Sample* dline, float position) const
+{
+    // get samples to be interpolated
+    float interp_amnt{position - std::floor(position)};
+    int samp1{static_cast<int>(std::floor(position))};
+    int samp2{samp1 + 1};
+    // ensure samples are within bounds
+    if (samp1 < 0) {samp1 += _max_delay;}
+    else if (samp1 >= _max_delay) {samp1 -= _max_delay;}
+    if (samp2 < 0) {samp2 += _max_delay;}
+    else if (samp2 >= _max_delay) {samp2 -= _max_delay;}
+    // if interp amount is very large or very small than round
+    if (interp_amnt < _snap_low) { interp_amnt = 0.0f;}
+    else if (interp_amnt > _snap_high) {interp_amnt = 1.0f;}
+
+    return (1.0f - interp_amnt) * SampleCodec<Sample>::decode(dline[samp1]) + interp_amnt * SampleCodec<Sample>::decode(dline[samp2]);
+}
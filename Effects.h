@@ -0,0 +1,64 @@
+#pragma once
+
+#include "DelayPreset.h"
+#include "FixedDelayEngine.h"
+
+#include <cstddef>
+
+// Effect chain of the pedal: a long delay followed by an optional chorus.
+// Shared by the firmware and the host renderer so workstation renders use the exact same engines and settings.
+
+static constexpr int SAMPLE_RATE{48000};
+// mono input is halved into both channels before the delay
+static constexpr float INPUT_GAIN{0.5f};
+
+/// constants for delay
+static constexpr int DELAY_VOICES{3};
+static constexpr int MAX_DELAY{SAMPLE_RATE * 2};
+// long delay lines are stored as 16 bit samples to halve sdram use and traffic
+using DelayEffect = FixedDelayEngine<DELAY_VOICES, MAX_DELAY, SAMPLE_RATE, int16_t>;
+// ratios are hardcoded temporarily, will be assigned to pots -- voices below 1.0f get shorter lines
+static constexpr float DELAY_RATIOS[DELAY_VOICES]{0.67f, 1.0f, 0.44f};
+// voices spread from left to right
+static constexpr float DELAY_PANS[DELAY_VOICES]{0.0f, 0.5f, 1.0f};
+
+/// constants for chorus
+static constexpr int CHORUS_VOICES{2};
+static constexpr int MAX_CHORUS_DELAY{SAMPLE_RATE / 50};
+// chorus reads are heavily modulated so they use cubic interpolation, the long delay stays linear
+using ChorusEffect = FixedDelayEngine<CHORUS_VOICES, MAX_CHORUS_DELAY, SAMPLE_RATE, float, Interpolation::HERMITE>;
+// add slight variation in delay time
+static constexpr float CHORUS_RATIOS[CHORUS_VOICES]{1.0f, 0.2f};
+static constexpr float CHORUS_MIX{1.0f};
+// fixed chorus sound, voices spread from left to right with the first one detuned
+static constexpr DelayPreset CHORUS_PRESET{
+    {static_cast<float>(MAX_CHORUS_DELAY), 0.13f, 0.35f},  //> delay time, feedback, flutter
+    {CHORUS_RATIOS[0], CHORUS_RATIOS[1]},
+    {0.0f, 1.0f},
+    {-300.0f, 0.0f},
+};
+
+// sets voice pans and flutter seed of the delay, call once after init since pans also offset the ping pong lfo phase
+inline void setupDelay(DelayEffect& delay, const float* pans = DELAY_PANS, uint32_t seed = NOISE_SEED)
+{
+    for (int voice_id{0}; voice_id < DELAY_VOICES; voice_id++) {delay.setPan(voice_id, pans[voice_id]);}
+    delay.setSeed(seed);
+}
+
+// recalls the fixed chorus sound, call after init -- it takes effect with the first block
+inline void setupChorus(ChorusEffect& chorus, uint32_t seed = NOISE_SEED)
+{
+    // chorus voices get streams apart from the delay voices so they don't flutter in step
+    chorus.setSeed(noiseSeed(seed, DELAY_VOICES));
+    chorus.recall(&CHORUS_PRESET);
+}
+
+// blends wet into dry in place, mix 0.0f is all dry and 1.0f all wet
+inline void mixStage(float* dry_left, float* dry_right, const float* wet_left, const float* wet_right, float mix, size_t frames)
+{
+    for (size_t i{0}; i < frames; i++)
+    {
+        dry_left[i] = wet_left[i] * mix + dry_left[i] * (1 - mix);
+        dry_right[i] = wet_right[i] * mix + dry_right[i] * (1 - mix);
+    }
+}
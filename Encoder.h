@@ -1,71 +1,124 @@
 #pragma once
 
+#include "SpscQueue.h"
+
 #include "daisy_seed.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Rotary encoder with push button, sampled from a timer interrupt instead of the control loop.
+// Every transition of the two quadrature channels is decoded through a state table, so fast turns aren't under counted
+// and contact bounce between two states cancels out. The button must hold a new level for several ticks before it counts.
+// Turns and button changes are queued, so steps aren't lost while the control loop is busy.
+// The pedal has no encoder wired yet. Firmware that adds one starts a daisy::TimerHandle at about 4kHz whose callback calls tick,
+// and drains poll in the control loop.
+
+// what an EncoderEvent reports
+enum class EncoderEventType : uint8_t
+{
+    TURN,       //> steps holds detents turned, positive is clockwise
+    PRESS,
+    RELEASE
+};
+
+struct EncoderEvent
+{
+    EncoderEventType type{};
+    int32_t steps{};
+};
+
 class Encoder
 {
 public:
+    static constexpr int TRANSITIONS_PER_STEP{4};   //> quadrature transitions between detents
+    static constexpr int DEBOUNCE_TICKS{8};         //> ticks the button must hold a new level, 2ms at 4kHz
+    static constexpr size_t QUEUE_SIZE{32};         //> events held until the control loop polls
+    static constexpr size_t BUTTON_RESERVE{8};      //> slots turns leave free, presses can't be merged like turns
+
     Encoder(){}
     ~Encoder(){}
 
+    // a and b are the quadrature channels, call before the timer starts ticking
     void init(daisy::GPIO* a, daisy::GPIO* b)
     {
         _a = a;
         _b = b;
-
-        _previous_a_state = _a->Read();
+        _state = readState();
+        _transitions = 0;
     }
-
+    // c is the push button, it reads low while pressed
     void init(daisy::GPIO* a, daisy::GPIO* b, daisy::GPIO* c)
     {
         init(a,b);
         _c = c;
         _button_state = !c->Read();
+        _debounce = 0;
+        _pressed.store(_button_state, std::memory_order_relaxed);
     }
-    // returns 1, -1, or 0 based on encoder movement
-    int process()
+
+    /// interrupt side
+
+    // samples the pins and queues whole steps and button changes
+    // call from a timer interrupt at least as often as the fastest edges, about 4kHz for a hand turned knob
+    void tick()
     {
-        const bool new_read = _a->Read();
-        const bool eval{new_read && !_previous_a_state};
-        _previous_a_state = new_read;
-        if (eval)
+        const uint8_t state {readState()};
+        _transitions += transition(_state, state);
+        _state = state;
+        const int steps {_transitions / TRANSITIONS_PER_STEP};
+        // a full queue keeps the transitions, so they go out as one larger turn with a later tick
+        if (steps != 0 && _events.size() < QUEUE_SIZE - BUTTON_RESERVE && _events.push({EncoderEventType::TURN, static_cast<int32_t>(steps)}))
         {
-            // clockwise rotation
-            if (!_b->Read()) {return 1;}
-            // counterclockwise rotation
-            else {return -1;}
+            _transitions -= steps * TRANSITIONS_PER_STEP;
         }
-        return 0;
-    }
 
-    bool isPressed() 
-    {
-        _button_state = !_c->Read();
-        return _button_state;
+        if (_c == nullptr) {return;}
+        const bool pressed {!_c->Read()};
+        if (pressed == _button_state) {_debounce = 0;}
+        else if (++_debounce >= DEBOUNCE_TICKS)
+        {
+            _debounce = DEBOUNCE_TICKS;
+            if (_events.push({pressed ? EncoderEventType::PRESS : EncoderEventType::RELEASE, 0}))
+            {
+                _button_state = pressed;
+                _pressed.store(pressed, std::memory_order_relaxed);
+                _debounce = 0;
+            }
+        }
     }
 
-    bool isReleased()
-    {
-        const bool new_read = !_c->Read();
-        const bool out {_button_state && !new_read};
-        _button_state = new_read;
-        return out;
-    }
+    /// control loop side
+
+    // takes the oldest event, returns false if there is none
+    bool poll(EncoderEvent& event) {return _events.pop(event);}
+    // returns debounced button state
+    bool isPressed() const {return _pressed.load(std::memory_order_relaxed);}
 
-    bool isClicked()  
-    {
-        const bool new_read = !_c->Read();
-        const bool out {!_button_state && new_read};
-        _button_state = new_read;
-        return out;
-    }
-    
 private:
     daisy::GPIO* _a{};
     daisy::GPIO* _b{};
     daisy::GPIO* _c{};
 
-    bool _previous_a_state{};
+    uint8_t _state{};               //> last sampled a << 1 | b
+    int _transitions{};             //> transitions not yet queued as steps
+    bool _button_state{};           //> debounced button level, owned by the interrupt
+    int _debounce{};                //> ticks the button has differed from _button_state
+    std::atomic<bool> _pressed{};   //> copy of _button_state for the control loop
+    SpscQueue<EncoderEvent, QUEUE_SIZE> _events{};
 
-    bool _button_state{};
-};
\ No newline at end of file
+    uint8_t readState() {return static_cast<uint8_t>((_a->Read() ? 2 : 0) | (_b->Read() ? 1 : 0));}
+    // returns change of position from previous to state, states are a << 1 | b
+    // moves that skip a state can't tell direction and count as none
+    static int transition(uint8_t previous, uint8_t state)
+    {
+        static constexpr int8_t TABLE[16] {
+            0, -1, 1, 0,
+            1, 0, 0, -1,
+            -1, 0, 0, 1,
+            0, 1, -1, 0
+        };
+        return TABLE[(previous << 2) | state];
+    }
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+#include "DelayBlock.h"
+#include "DelayControls.h"
+#include "DelayMemory.h"
+#include "DelayPreset.h"
+#include "DelayVoiceBank.h"
+#include "TripleBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Delay engine with voice count, max delay and sample rate fixed at compile time.
+// Parameters live in member arrays so no heap is used, and the packed kernel is specialized on the sizes and interpolation
+// so voice loops unroll and the sample rate divisions fold to constants.
+// Delay lines are passed to init or taken from a DelayMemory so they can be placed in SDRAM or on-chip memory.
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample = float, Interpolation INTERP = Interpolation::LINEAR>
+class FixedDelayEngine
+{
+    static_assert(VOICES <= DelayControls::MAX_BYPASS_VOICES, "bypass mask can't hold every voice");
+
+public:
+    // size of the longest voice's delay line in samples, rounded up to a power of two
+    static constexpr int LINE_SIZE{ringCapacity(MAX_DELAY)};
+    // required size of each buffer passed to init when every voice has a full line
+    static constexpr int BUFFER_SIZE{DelayVoiceBank::bufferSize(MAX_DELAY, VOICES, RingMode::POWER_OF_TWO)};
+
+    // returns samples needed in each buffer passed to init, voices with max_ratios below 1.0f get shorter lines
+    static constexpr int bufferSize(const float* max_ratios = nullptr) {return DelayVoiceBank::bufferSize(MAX_DELAY, VOICES, RingMode::POWER_OF_TWO, false, max_ratios);}
+    // returns bytes of memory init takes from a DelayMemory
+    static constexpr size_t memorySize(const float* max_ratios = nullptr) {return DelayMemory::stereoSize(static_cast<size_t>(bufferSize(max_ratios)) * sizeof(Sample));}
+
+    FixedDelayEngine() {}
+    // the bank points into the engine's member arrays, a copy would write into the source engine
+    FixedDelayEngine(const FixedDelayEngine&) = delete;
+    FixedDelayEngine& operator=(const FixedDelayEngine&) = delete;
+
+    // initializes engine, each buffer must hold bufferSize(max_ratios) samples
+    // max_ratios holds the largest delay ratio each voice will be set to, or nullptr for 1.0f, and sets the initial ratios
+    void init(Sample* buffer1, Sample* buffer2, const float* max_ratios = nullptr);
+    // initializes engine with buffers taken from memory, small engines land in FAST memory
+    // returns false if memory has no room, the engine must not be used then
+    bool init(DelayMemory& memory, const float* max_ratios = nullptr)
+    {
+        Sample* left{};
+        Sample* right{};
+        if (!memory.allocateStereo(static_cast<size_t>(bufferSize(max_ratios)), left, right)) {return false;}
+        init(left, right, max_ratios);
+        return true;
+    }
+    // processes new sample
+    void process(float left, float right);
+    void process(float in) {process(in * 0.5f, in * 0.5f);}
+    // processes a block of any size of stereo samples and writes the summed voice output -- out buffers must not alias in buffers
+    void process(const float* in_left, const float* in_right, float* out_left, float* out_right, size_t size)
+    {
+        // controls are applied at sub-block starts counted across calls, so the host block size doesn't change the output
+        _block_clock.split(size, [&](size_t offset, size_t frames, bool start)
+        {
+            if (start)
+            {
+                applyControls();
+                applyPreset();
+                _bank.startSubBlock();
+            }
+            _bank.template processFixed<VOICES, LINE_SIZE, SAMPLE_RATE, INTERP, Sample>(in_left + offset, in_right + offset, out_left + offset, out_right + offset, frames);
+        });
+    }
+    // get stereo output
+    float getLeft() const {return _bank.getLeft();}
+    float getRight() const {return _bank.getRight();}
+
+    /// control setters
+    // safe to call while audio runs, values are handed to the audio thread and applied together at the start of the next block
+
+    // sets master delay time in samples
+    void setMasterDelayTime(float samples);
+    // set master feedback in range 0.0f to 1.0f
+    void setMasterFeedback(float feedback);
+    // sets master flutter in range 0.0f to 1.0f
+    void setMasterFlutter(float flutter);
+    // set ping pong mode to on or off
+    void setPingPongMode(bool b) {_controls.ping_pong = b; publishControls();}
+    // set bypass of specific voice to true or false
+    void setBypass(int voice_id, bool b);
+
+    /// setup setters
+    // change voices directly, call before audio starts
+
+    // set delay ratio of specific voice in range 0.0f to 1.0f, takes effect with the next master delay time
+    // delay time stays within the line planned for the voice at init
+    void setDelayRatio(int voice_id, float ratio) {_ratios[voice_id] = enforceRatio(ratio);}
+    // set pan of specific voice in range 0.0f to 1.0f
+    void setPan(int voice_id, float pan) {_bank.setPan(voice_id, enforceRatio(pan));}
+    // set detune in samples to stretch
+    void setDetune(int voice_id, float detune) {_bank.setDetune(voice_id, detune);}
+    // set samples between flutter and pan updates, 1 updates every sample
+    void setControlInterval(int samples) {_bank.setControlInterval(samples);}
+    // set sub-block size controls are applied at and the matching flutter and pan interval, LOW_LATENCY by default
+    void setBlockMode(BlockMode mode)
+    {
+        _block_mode = mode;
+        _block_clock.setFrames(blockModeFrames(mode));
+        setControlInterval(blockModeInterval(mode));
+    }
+    // let voices whose lines have decayed to silence skip processing until new input arrives, on by default
+    // bypassed voices skip processing too and their lines are frozen until they return
+    void setSleep(bool b) {_bank.setSleep(b);}
+    // set seed of the flutter noise, equal seeds give equal flutter and every voice gets its own stream of it
+    void setSeed(uint32_t seed) {_bank.setSeed(seed);}
+
+    /// presets
+    // the engine keeps pointers to recalled presets, they must stay unchanged until getMorphing returns false
+
+    // copies current parameters to preset, call while no morph runs
+    void capture(DelayPreset& preset) const;
+    // switches every parameter to preset at the start of the next block
+    void recall(const DelayPreset* preset) {morph(preset, preset, 0);}
+    // moves parameters from one preset to another over frames, rounded up to whole sub-blocks, starting with the next block
+    // values are interpolated once per sub-block, ping pong and bypass switch halfway
+    // controls set during a morph start from to and take effect when it ends, a new recall or morph replaces a running one
+    void morph(const DelayPreset* from, const DelayPreset* to, int frames);
+
+    /// getters
+
+    // returns delay time in samples
+    float getMasterDelayTime() const {return _controls.master_delay_time;}
+    // returns feedback in range 0.0f to 1.0f
+    float getMasterFeedback() const {return _controls.master_feedback;}
+    // returns flutter in range 0.0f to 1.0f
+    float getMasterFlutter() const {return _controls.master_flutter;}
+    // returns voice count
+    int getVoiceCount() const {return VOICES;}
+    // returns max delay per voice in samples
+    int getMaxDelay() const {return LINE_SIZE;}
+    // returns interpolation used to read delay lines
+    Interpolation getInterpolation() const {return INTERP;}
+    // returns sub-block size mode
+    BlockMode getBlockMode() const {return _block_mode;}
+    // returns seed of the flutter noise
+    uint32_t getSeed() const {return _bank.getSeed();}
+    // returns number of sleeping voices
+    int getSleepingVoices() const {return _bank.getSleepingVoices();}
+    // returns true until the audio thread has finished the last recall or morph
+    bool getMorphing() const {return _preset_done.load(std::memory_order_acquire) != _preset.id;}
+
+private:
+    DelayVoiceBank _bank{};
+    float _params[VOICES * DelayVoiceBank::PARAM_COUNT]{};     //> storage for the bank's per voice parameters
+    int _lines[VOICES * DelayVoiceBank::LINE_PARAM_COUNT]{};   //> storage for the bank's line layout
+    DelayVoiceBank::VoiceModulators _mods[VOICES]{};
+    float _ratios[VOICES]{};    //> ratios of per voice delay time to master delay time
+    // control parameters
+    DelayControls _controls{};                  //> latest values set by the control thread
+    DelayPresetRequest _preset{};               //> latest recall or morph made by the control thread
+    TripleBuffer<DelayHandoff> _handoff{};      //> passes _controls and _preset to the audio thread
+    DelayControls _applied{};                   //> values the audio thread has applied to the voices
+    // preset members
+    DelayPresetRequest _morph{};                //> recall or morph the audio thread is running
+    int _morph_block{};                         //> sub-blocks of _morph applied so far
+    std::atomic<uint32_t> _preset_done{0};      //> id of the last request the audio thread finished
+    // sub-block members
+    BlockMode _block_mode{BlockMode::LOW_LATENCY};
+    SubBlockClock _block_clock{};               //> finds sub-block starts in host blocks
+
+    // hands a copy of _controls and _preset to the audio thread
+    void publishControls() {_handoff.write() = {_controls, _preset}; _handoff.publish();}
+    // takes the latest published controls and starts a new recall or morph, called by the audio thread before processing
+    // controls are applied unless a morph runs
+    void applyControls();
+    // applies values that differ from _applied to voices
+    void applyControlValues(const DelayControls& controls);
+    // applies the next sub-block of a running recall or morph, then the latest controls once it ends
+    void applyPreset();
+    // ensures that x is between 0.0f and 1.0f
+    static float enforceRatio(float x) {return std::min(1.0f, std::max(0.0f, x));}
+};
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::init(Sample* buffer1, Sample* buffer2, const float* max_ratios)
+{
+    // bank uses member arrays instead of allocating, it zeroes its own delay lines
+    _bank.setStorage(_params, _lines, _mods);
+    _bank.init(buffer1, buffer2, MAX_DELAY, VOICES, SAMPLE_RATE, RingMode::POWER_OF_TWO, false, max_ratios);
+    for (int voice_id{0}; voice_id < VOICES; voice_id++)
+    {
+        _ratios[voice_id] = max_ratios != nullptr ? enforceRatio(max_ratios[voice_id]) : 1.0f;
+    }
+    _block_clock.setFrames(blockModeFrames(_block_mode));
+    // voices start from defaults, so controls of an earlier init must be applied again
+    _controls = {};
+    _applied = {};
+    // a preset recalled before init doesn't run again
+    _morph = _preset;
+    _morph_block = _morph.blocks;
+    _preset_done.store(_preset.id, std::memory_order_release);
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::process(float left, float right)
+{
+    float left_out{};
+    float right_out{};
+    process(&left, &right, &left_out, &right_out, 1);
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::setMasterDelayTime(float samples)
+{
+    // ensure samples are in range
+    if (samples < 0.01f) {samples = 0.01f;}
+    else if (samples >= LINE_SIZE) {samples = LINE_SIZE - 1;}
+    _controls.master_delay_time = samples;
+    publishControls();
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::setMasterFeedback(float feedback)
+{
+    // ensure feedback is in range
+    _controls.master_feedback = enforceRatio(feedback);
+    publishControls();
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::setMasterFlutter(float flutter)
+{
+    // ensure flutter is in range
+    _controls.master_flutter = enforceRatio(flutter);
+    publishControls();
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::setBypass(int voice_id, bool b)
+{
+    if (voice_id < 0 || voice_id >= VOICES) {return;}
+    const uint64_t bit {uint64_t{1} << voice_id};
+    _controls.bypass_mask = b ? _controls.bypass_mask | bit : _controls.bypass_mask & ~bit;
+    publishControls();
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::capture(DelayPreset& preset) const
+{
+    preset.controls = _controls;
+    for (int voice_id{0}; voice_id < VOICES; voice_id++)
+    {
+        preset.ratio[voice_id] = _ratios[voice_id];
+        preset.pan[voice_id] = _bank.getPan(voice_id);
+        preset.detune[voice_id] = _bank.getDetune(voice_id);
+    }
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::morph(const DelayPreset* from, const DelayPreset* to, int frames)
+{
+    if (to == nullptr) {return;}
+    if (from == nullptr) {from = to;}
+    _preset = {from, to, presetBlocks(frames, blockModeFrames(_block_mode)), _preset.id + 1};
+    // later control changes start from the preset's values
+    _controls = to->controls;
+    publishControls();
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::applyControls()
+{
+    if (!_handoff.update()) {return;}
+    const DelayHandoff& handoff {_handoff.read()};
+    if (handoff.preset.id != _morph.id)
+    {
+        _morph = handoff.preset;
+        _morph_block = 0;
+    }
+    // controls published with or during a morph are applied when it ends
+    if (_morph_block < _morph.blocks) {return;}
+    applyControlValues(handoff.controls);
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::applyControlValues(const DelayControls& controls)
+{
+    // only changed values are applied, reapplying delay time would undo flutter drift
+    const uint64_t bypass_changed {controls.bypass_mask ^ _applied.bypass_mask};
+    for (int voice_id{0}; voice_id < VOICES; voice_id++)
+    {
+        if (controls.master_delay_time != _applied.master_delay_time)
+        {
+            _bank.setDelayTime(voice_id, controls.master_delay_time * _ratios[voice_id]);
+        }
+        if (controls.master_feedback != _applied.master_feedback) {_bank.setFeedback(voice_id, controls.master_feedback);}
+        if (controls.master_flutter != _applied.master_flutter) {_bank.setFlutter(voice_id, controls.master_flutter);}
+        if (((bypass_changed >> voice_id) & 1) != 0) {_bank.setBypass(voice_id, ((controls.bypass_mask >> voice_id) & 1) != 0);}
+    }
+    if (controls.ping_pong != _applied.ping_pong) {_bank.setPingPongMode(controls.ping_pong);}
+    _applied = controls;
+}
+
+template <int VOICES, int MAX_DELAY, int SAMPLE_RATE, typename Sample, Interpolation INTERP>
+void FixedDelayEngine<VOICES, MAX_DELAY, SAMPLE_RATE, Sample, INTERP>::applyPreset()
+{
+    if (_morph_block >= _morph.blocks) {return;}
+    const DelayPreset& from {*_morph.from};
+    const DelayPreset& to {*_morph.to};
+    const bool first {_morph_block == 0};
+    _morph_block++;
+    const float amount {static_cast<float>(_morph_block) / static_cast<float>(_morph.blocks)};
+
+    // switches can't be blended, they take the nearer preset's value
+    DelayControls controls {amount < 0.5f ? from.controls : to.controls};
+    controls.master_delay_time = presetMix(from.controls.master_delay_time, to.controls.master_delay_time, amount);
+    controls.master_feedback = presetMix(from.controls.master_feedback, to.controls.master_feedback, amount);
+    controls.master_flutter = presetMix(from.controls.master_flutter, to.controls.master_flutter, amount);
+    const bool master_moved {controls.master_delay_time != _applied.master_delay_time};
+
+    // voice values both presets share are only set on the first sub-block, reapplying delay time would undo flutter drift
+    for (int voice_id{0}; voice_id < VOICES; voice_id++)
+    {
+        if (first || from.ratio[voice_id] != to.ratio[voice_id])
+        {
+            _ratios[voice_id] = enforceRatio(presetMix(from.ratio[voice_id], to.ratio[voice_id], amount));
+            // a moving master delay time sets every voice below
+            if (!master_moved) {_bank.setDelayTime(voice_id, controls.master_delay_time * _ratios[voice_id]);}
+        }
+        // the ping pong lfo keeps its phase, setPan would shift it on every sub-block
+        if (first || from.pan[voice_id] != to.pan[voice_id]) {_bank.movePan(voice_id, presetMix(from.pan[voice_id], to.pan[voice_id], amount));}
+        if (first || from.detune[voice_id] != to.detune[voice_id]) {_bank.setDetune(voice_id, presetMix(from.detune[voice_id], to.detune[voice_id], amount));}
+    }
+    applyControlValues(controls);
+
+    if (_morph_block < _morph.blocks) {return;}
+    // controls set since the request differ from to only where they were changed
+    applyControlValues(_handoff.read().controls);
+    _preset_done.store(_morph.id, std::memory_order_release);
+}
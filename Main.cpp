@@ -1,66 +1,119 @@
-#include "DelayEngine.h"
-#include "Encoder.h"
-#include "Potentiometer.h"
+#include "ControlInputs.h"
+#include "DelayProfiler.h"
+#include "Effects.h"
+#include "Telemetry.h"
 
 //#include "lcd_hd44780.h"
 #include "daisy_seed.h"
 
-#include <map>
-
 ///*** Global Values ***///
-static constexpr int SAMPLE_RATE{48000};
-/// constants for delay
-static constexpr int DELAY_VOICES{3};
-static constexpr int MAX_DELAY{SAMPLE_RATE * 2};
-float DSY_SDRAM_BSS DELAY_LEFT_BUFFER[MAX_DELAY * DELAY_VOICES];
-float DSY_SDRAM_BSS DELAY_RIGHT_BUFFER[MAX_DELAY * DELAY_VOICES];
-
-/// constants for chorus
-static constexpr int CHORUS_VOICES{2};
-static constexpr int MAX_CHORUS_DELAY{SAMPLE_RATE / 50};
-// multiply by 2 because each delay voice needs two delay lines
-float DSY_SDRAM_BSS CHORUS_LEFT_BUFFER[MAX_CHORUS_DELAY * CHORUS_VOICES];
-float DSY_SDRAM_BSS CHORUS_RIGHT_BUFFER[MAX_CHORUS_DELAY * CHORUS_VOICES];
+// sample rate, engine types and ratios of the delay and chorus are in Effects.h
+
+/// delay line memory
+// engines take their left and right lines from here, placed by size, and each tier is sized by the engines placed in it
+// short chorus lines go to on-chip DTCM so modulated reads don't wait on SDRAM
+static constexpr size_t FAST_MEMORY_SIZE{ChorusEffect::memorySize(CHORUS_RATIOS)};
+static_assert(ChorusEffect::bufferSize(CHORUS_RATIOS) * sizeof(float) <= DelayMemory::DEFAULT_FAST_LIMIT, "chorus lines won't be placed in fast memory");
+alignas(DelayMemory::ALIGNMENT) uint8_t DTCM_MEM_SECTION FAST_MEMORY[FAST_MEMORY_SIZE];
+// 2 second delay lines only fit in SDRAM, they are rounded up to a power of two so reads wrap with a mask
+static constexpr size_t BULK_MEMORY_SIZE{DelayEffect::memorySize(DELAY_RATIOS)};
+alignas(DelayMemory::ALIGNMENT) uint8_t DSY_SDRAM_BSS BULK_MEMORY[BULK_MEMORY_SIZE];
+DelayMemory memory{};
+
+/// audio block constants
+// sets the callback size and the sub-blocks engines apply controls at, larger modes trade latency for cpu per frame
+static constexpr BlockMode BLOCK_MODE{BlockMode::LOW_LATENCY};
+static constexpr size_t MAX_BLOCK_SIZE{blockModeFrames(BlockMode::THROUGHPUT)};	//> max frames processed per engine call, larger callbacks are split
+// build with DELAY_PROFILE=1 to time each stage, a report of mean and peak load per stage is logged about once a second
+static constexpr int PROFILE_REPORT_BLOCKS{SAMPLE_RATE / blockModeFrames(BLOCK_MODE)};
+static_assert(static_cast<int>(TelemetryId::PROFILE_OVER) - static_cast<int>(TelemetryId::PROFILE_CALLBACK) == static_cast<int>(ProfileStage::COUNT),
+				"every profile stage needs a telemetry id");
+
+/// telemetry constants
+// queued values are printed at most this often, so the control loop never waits on usb
+static constexpr uint32_t TELEMETRY_INTERVAL_US{100000};
+
+/// pot constants
+enum AdcChannel {
+	TIME = 0,
+	FEEDBACK,
+	FLUTTER,
+	MIX,
+	NUM_POTS
+};
 
 daisy::DaisySeed hw{}; //> Daisy seed hardware object
 daisy::CpuLoadMeter load_meter{};
+Telemetry telemetry{};
+// pots are smoothed in the audio callback at a fixed rate and handed to the control loop as events
+ControlInputs<NUM_POTS> pots{};
 
-// init effects
-DelayEngine delay{};
-DelayEngine chorus{};
+// init effects, sizes are fixed at compile time so each engine gets its own specialized kernel
+DelayEffect delay{};
+ChorusEffect chorus{};
 float delay_mix{0.0f};
-static constexpr float chorus_mix{1.0};
 static bool chorus_on{false};
 
 void AudioCallback(daisy::AudioHandle::InterleavingInputBuffer in, daisy::AudioHandle::InterleavingOutputBuffer out, size_t size)
 {
 	load_meter.OnBlockStart();
-    for (size_t i = 0; i < size; i+=2)
-    {
-		float left_out{in[i] * 0.5f};
-		float right_out{in[i] * 0.5f};
+	const uint32_t block_start{daisy::System::GetUs()};
+	DELAY_PROFILE_BLOCK();
+	pots.process(size / 2);
+	// scratch buffers for deinterleaved audio
+	float dry_left[MAX_BLOCK_SIZE];
+	float dry_right[MAX_BLOCK_SIZE];
+	float wet_left[MAX_BLOCK_SIZE];
+	float wet_right[MAX_BLOCK_SIZE];
+	const float mix{delay_mix};
+	const bool chorus_active{chorus_on};
+
+	// size counts interleaved samples, process in chunks of at most MAX_BLOCK_SIZE frames
+	for (size_t offset = 0; offset < size; offset += MAX_BLOCK_SIZE * 2)
+	{
+		const size_t frames{std::min(MAX_BLOCK_SIZE, (size - offset) / 2)};
+		for (size_t i = 0; i < frames; i++)
+		{
+			dry_left[i] = in[offset + i * 2] * INPUT_GAIN;
+			dry_right[i] = in[offset + i * 2] * INPUT_GAIN;
+		}
 
 		// delay stage
-		delay.process(left_out, right_out);
-        left_out = delay.getLeft() * delay_mix + left_out * (1 - delay_mix);
-        right_out = delay.getRight() * delay_mix + right_out * (1 - delay_mix);
+		{
+			DELAY_PROFILE_SCOPE(DELAY);
+			delay.process(dry_left, dry_right, wet_left, wet_right, frames);
+		}
+		mixStage(dry_left, dry_right, wet_left, wet_right, mix, frames);
 
 		// chorus stage
-		if (chorus_on)
+		if (chorus_active)
 		{
-			chorus.process(left_out, right_out);
-			left_out = chorus.getLeft() * chorus_mix + left_out * (1 - chorus_mix);
-			right_out = chorus.getRight() * chorus_mix + right_out * (1 - chorus_mix);
+			{
+				DELAY_PROFILE_SCOPE(CHORUS);
+				chorus.process(dry_left, dry_right, wet_left, wet_right, frames);
+			}
+			mixStage(dry_left, dry_right, wet_left, wet_right, CHORUS_MIX, frames);
 		}
 
 		// passthrough
 		// out[i] = in[i];
 		// out[i+1] = in[i];
 
-		out[i] = left_out;
-		out[i+1] = right_out;
-    }
+		for (size_t i = 0; i < frames; i++)
+		{
+			out[offset + i * 2] = dry_left[i];
+			out[offset + i * 2 + 1] = dry_right[i];
+		}
+	}
 	load_meter.OnBlockEnd();
+
+	// log overruns without waiting, the control loop prints them later
+	const uint32_t elapsed{daisy::System::GetUs() - block_start};
+	const uint32_t budget{static_cast<uint32_t>(size / 2 * 1000000 / SAMPLE_RATE)};
+	if (elapsed > budget)
+	{
+		telemetry.logAudio({block_start, TelemetryId::OVERRUN, static_cast<float>(elapsed), static_cast<float>(elapsed) / static_cast<float>(budget)});
+	}
 }
 
 int main(void)
@@ -68,48 +121,41 @@ int main(void)
 	///*** Init section ***///
 	// init hardware
 	hw.Init();
-	hw.SetAudioBlockSize(4); //> number of samples handled per callback
+	hw.SetAudioBlockSize(blockModeFrames(BLOCK_MODE)); //> number of samples handled per callback
 	hw.SetAudioSampleRate(daisy::SaiHandle::Config::SampleRate::SAI_48KHZ);
 	hw.StartLog();
 	const float hw_sample_rate {hw.AudioSampleRate()};
 
 	// init load meter
 	load_meter.Init(hw_sample_rate,hw.AudioBlockSize());
+	telemetry.init(TELEMETRY_INTERVAL_US);
+#if DELAY_PROFILE
+	delayProfiler().init(hw_sample_rate, hw.AudioBlockSize(), PROFILE_REPORT_BLOCKS);
+#endif
 	
+	/// init delay line memory
+	memory.init(FAST_MEMORY, FAST_MEMORY_SIZE, BULK_MEMORY, BULK_MEMORY_SIZE);
+
 	/// init delay 
-	delay.init(DELAY_LEFT_BUFFER, DELAY_RIGHT_BUFFER, MAX_DELAY, DELAY_VOICES, SAMPLE_RATE);
+	const bool delay_placed {delay.init(memory, DELAY_RATIOS)};
+	delay.setBlockMode(BLOCK_MODE);
 	// set pans of voices
-	delay.setPan(0,0.0f);
-	delay.setPan(1,0.5f);
-	delay.setPan(2,1.0f);
-	// ratios are hardcoded temporarily, will be assigned to pots
-	delay.setDelayRatio(0,0.67f);
-	delay.setDelayRatio(1,1.0f);
-	delay.setDelayRatio(2,0.44f);
+	setupDelay(delay);
 
 	/// init chorus
-	chorus.init(CHORUS_LEFT_BUFFER, CHORUS_RIGHT_BUFFER, MAX_CHORUS_DELAY, CHORUS_VOICES, SAMPLE_RATE);
-	// set voice panning
-	chorus.setPan(0,0.0f);
-	chorus.setPan(1,1.0f);
-	// add slight variation in delay time
-	chorus.setDelayRatio(0,1.0f);
-	chorus.setDelayRatio(1,0.2f);
-	chorus.setMasterFlutter(0.35f);
-	chorus.setDetune(0,-300.0f);
-	chorus.setMasterFeedback(0.13f);
-	chorus.setMasterDelayTime(MAX_CHORUS_DELAY);
+	const bool chorus_placed {chorus.init(memory, CHORUS_RATIOS)};
+	chorus.setBlockMode(BLOCK_MODE);
+	// set voice panning and chorus sound
+	setupChorus(chorus);
 
-	hw.StartAudio(AudioCallback);
+	// memory arrays are sized from the engines, so this only fails if they are changed by hand
+	if (!delay_placed || !chorus_placed)
+	{
+		hw.PrintLine("delay line memory is too small");
+		while (1) {}
+	}
 
 	// Configure ADC channel
-	constexpr int NUM_POTS{4};
-	enum AdcChannel {
-		TIME = 0,
-		FEEDBACK,
-		FLUTTER,
-		MIX
-	};
 	daisy::AdcChannelConfig adc_channel_config[NUM_POTS]{};
 	// init adc ports
 	adc_channel_config[TIME].InitSingle(daisy::seed::A11);
@@ -117,13 +163,16 @@ int main(void)
 	adc_channel_config[FLUTTER].InitSingle(daisy::seed::A9);
 	adc_channel_config[MIX].InitSingle(daisy::seed::A8);
 	hw.adc.Init(adc_channel_config,NUM_POTS);	//> give handle to adc_cahnnel_config array and length
-	hw.adc.Start(); //> start adc
+	hw.adc.Start(); //> start adc, DMA keeps every channel's latest sample in memory from here on
 	// Init Potentiometers (all pots are currently reversed due to prototype wiring error that is better solved in software)
-	std::map<AdcChannel,Potentiometer> pot_map{};
-	pot_map[TIME].init(&hw,TIME,true);
-	pot_map[FEEDBACK].init(&hw,FEEDBACK,true);
-	pot_map[FLUTTER].init(&hw,FLUTTER,true);
-	pot_map[MIX].init(&hw,MIX,true);
+	pots.init(hw_sample_rate);
+	for (int channel = 0; channel < NUM_POTS; channel++)
+	{
+		pots.setSource(channel, hw.adc.GetPtr(channel), true);
+	}
+
+	// pots are read by the callback, so audio starts once they are set up
+	hw.StartAudio(AudioCallback);
 
 	/// init switches
 	daisy::GPIO voice1_switch{};
@@ -149,33 +198,63 @@ int main(void)
 	///*** Pogram Loop ***///
 	while(1)
 	{
-		delay.setBypass(0,voice1_switch.Read());
-		delay.setBypass(1,voice2_switch.Read());
-		delay.setBypass(2,voice3_switch.Read());
-		delay.setPingPongMode(!ping_pong_switch.Read());
+		const bool voice1_bypass{voice1_switch.Read()};
+		const bool voice2_bypass{voice2_switch.Read()};
+		const bool voice3_bypass{voice3_switch.Read()};
+		const bool ping_pong{!ping_pong_switch.Read()};
+		delay.setBypass(0,voice1_bypass);
+		delay.setBypass(1,voice2_bypass);
+		delay.setBypass(2,voice3_bypass);
+		delay.setPingPongMode(ping_pong);
 		chorus_on = !chorus_switch.Read();
 
-		hw.PrintLine("Time:%f Feedback:%f Flutter:%f Mix:%f",
-						(delay.getMasterDelayTime() / static_cast<float>(SAMPLE_RATE)) * 1000.0f, 
-						delay.getMasterFeedback(),
-						delay.getMasterFlutter(),
-						delay_mix);
-		// process pots
-		if (pot_map[TIME].process())
-		{
-			delay.setMasterDelayTime(pot_map[TIME].getVal() * MAX_DELAY);
-		}
-		if (pot_map[FEEDBACK].process())
-		{
-			delay.setMasterFeedback(pot_map[FEEDBACK].getVal());
-		}
-		if (pot_map[FLUTTER].process())
+		// log changed values, printing happens in flush at TELEMETRY_INTERVAL_US
+		const uint32_t now{daisy::System::GetUs()};
+		const float load{load_meter.GetAvgCpuLoad()};
+		telemetry.logChange(now, TelemetryId::TIME, (delay.getMasterDelayTime() / static_cast<float>(SAMPLE_RATE)) * 1000.0f, load);
+		telemetry.logChange(now, TelemetryId::FEEDBACK, delay.getMasterFeedback(), load);
+		telemetry.logChange(now, TelemetryId::FLUTTER, delay.getMasterFlutter(), load);
+		telemetry.logChange(now, TelemetryId::MIX, delay_mix, load);
+		telemetry.logChange(now, TelemetryId::PING_PONG, ping_pong ? 1.0f : 0.0f, load);
+		telemetry.logChange(now, TelemetryId::CHORUS, chorus_on ? 1.0f : 0.0f, load);
+		telemetry.logChange(now, TelemetryId::BYPASS, static_cast<float>(voice1_bypass | (voice2_bypass << 1) | (voice3_bypass << 2)), load);
+		// load is logged in whole percent so it only logs when it moves
+		telemetry.logChange(now, TelemetryId::LOAD, std::round(load * 100.0f) * 0.01f, load);
+		telemetry.flush(now, [](const char* line) {hw.PrintLine("%s", line);});
+#if DELAY_PROFILE
+		// the report is queued like any other telemetry so it is printed by flush without stalling the loop
+		if (delayProfiler().update())
 		{
-			delay.setMasterFlutter(pot_map[FLUTTER].getVal());
+			const ProfileReport& report {delayProfiler().read()};
+			for (int stage = 0; stage < static_cast<int>(ProfileStage::COUNT); stage++)
+			{
+				const ProfileStats& stats {report.stages[stage]};
+				const TelemetryId id {static_cast<TelemetryId>(static_cast<int>(TelemetryId::PROFILE_CALLBACK) + stage)};
+				telemetry.log(now, id, stats.mean() / report.budget, static_cast<float>(stats.max) / report.budget);
+			}
+			const ProfileStats& callback {report.stage(ProfileStage::CALLBACK)};
+			telemetry.log(now, TelemetryId::PROFILE_OVER, static_cast<float>(callback.load[ProfileStats::LOAD_BINS - 1]), load);
 		}
-		if (pot_map[MIX].process())
+#endif
+		// apply pot changes
+		ControlEvent event{};
+		while (pots.poll(event))
 		{
-			delay_mix = pot_map[MIX].getVal();
+			switch (event.channel)
+			{
+			case TIME:
+				delay.setMasterDelayTime(event.value * MAX_DELAY);
+				break;
+			case FEEDBACK:
+				delay.setMasterFeedback(event.value);
+				break;
+			case FLUTTER:
+				delay.setMasterFlutter(event.value);
+				break;
+			case MIX:
+				delay_mix = event.value;
+				break;
+			}
 		}
 
 		// print to lcd screen
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free single producer, single consumer queue of up to SIZE values in a fixed array.
+// Neither side waits: push fails when the queue is full and pop fails when it is empty, so an interrupt can be the producer.
+// Positions count up forever and are masked into the array, SIZE must be a power of two.
+template <typename T, size_t SIZE>
+class SpscQueue
+{
+public:
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "queue size must be a power of two");
+
+    SpscQueue() {}
+
+    /// producer side
+
+    // copies value to the back of the queue, returns false if it is full
+    bool push(const T& value)
+    {
+        const uint32_t tail {_tail.load(std::memory_order_relaxed)};
+        if (tail - _head.load(std::memory_order_acquire) >= SIZE) {return false;}
+        _slots[tail & MASK] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// consumer side
+
+    // moves the front value to value, returns false if the queue is empty
+    bool pop(T& value)
+    {
+        const uint32_t head {_head.load(std::memory_order_relaxed)};
+        if (head == _tail.load(std::memory_order_acquire)) {return false;}
+        value = _slots[head & MASK];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // returns true if there is nothing to pop
+    bool empty() const {return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire);}
+
+    /// either side
+
+    // returns number of queued values, the producer may see more than there are but never fewer
+    size_t size() const {return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);}
+
+    // returns number of values the queue holds
+    static constexpr size_t capacity() {return SIZE;}
+
+private:
+    static constexpr uint32_t MASK{SIZE - 1};
+
+    T _slots[SIZE]{};
+    std::atomic<uint32_t> _head{0};     //> position of the next pop, written by consumer
+    std::atomic<uint32_t> _tail{0};     //> position of the next push, written by producer
+};
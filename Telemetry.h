@@ -0,0 +1,157 @@
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Binary log of control changes and audio events, formatted and printed by the control loop at a low fixed rate.
+// Logging only copies a small record into a lock-free queue, so neither the control loop nor the audio callback waits on the serial port.
+// Records that don't fit before the next flush are dropped and counted instead of blocking.
+
+// logged values
+enum class TelemetryId : uint8_t
+{
+    TIME,       //> master delay time in milliseconds
+    FEEDBACK,
+    FLUTTER,
+    MIX,
+    PING_PONG,  //> 1 when on
+    CHORUS,     //> 1 when on
+    BYPASS,     //> bit n set when voice n is bypassed
+    LOAD,       //> average cpu load of the audio callback
+    OVERRUN,    //> audio callback ran longer than its block, value is its length in microseconds
+    // DELAY_PROFILE report, one per ProfileStage in the same order
+    // value is the stage's mean time as a share of the block budget, load is its peak share
+    PROFILE_CALLBACK,
+    PROFILE_DELAY,
+    PROFILE_CHORUS,
+    PROFILE_KERNEL,
+    PROFILE_MODULATION,
+    PROFILE_INTERPOLATION,
+    PROFILE_OVER,       //> callback blocks over budget in the report window
+    COUNT
+};
+
+// returns name printed for id
+inline const char* telemetryName(TelemetryId id)
+{
+    static const char* const NAMES[] {"time", "feedback", "flutter", "mix", "ping_pong", "chorus", "bypass", "load", "overrun",
+        "prof_callback", "prof_delay", "prof_chorus", "prof_kernel", "prof_modulation", "prof_interpolation", "prof_over"};
+    static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == static_cast<size_t>(TelemetryId::COUNT), "every id needs a name");
+    return id < TelemetryId::COUNT ? NAMES[static_cast<int>(id)] : "?";
+}
+
+// one logged value, copied through the queues as is
+struct TelemetryRecord
+{
+    uint32_t time{};    //> microseconds on the caller's clock
+    TelemetryId id{};
+    float value{};
+    float load{};       //> cpu load when logged, 1.0f is a full block
+};
+
+class Telemetry
+{
+public:
+    static constexpr size_t QUEUE_SIZE{64};     //> records each side can hold between flushes
+    static constexpr int MAX_LINES{8};          //> lines printed per flush, later records wait for the next one
+    static constexpr size_t LINE_SIZE{64};
+
+    Telemetry() {}
+
+    // flush_interval is the least time between flushes in microseconds
+    void init(uint32_t flush_interval)
+    {
+        _flush_interval = flush_interval;
+        for (bool& logged : _logged) {logged = false;}
+    }
+
+    /// control loop side
+
+    // queues a record, returns false if the queue is full
+    bool log(uint32_t time, TelemetryId id, float value, float load)
+    {
+        if (_control.push({time, id, value, load})) {return true;}
+        _control_dropped++;
+        return false;
+    }
+    // queues a record only if value differs from the last one logged for id, values should be quantized by the caller
+    bool logChange(uint32_t time, TelemetryId id, float value, float load)
+    {
+        const int index {static_cast<int>(id)};
+        if (_logged[index] && _last[index] == value) {return true;}
+        // a dropped change is tried again on the next call
+        if (!log(time, id, value, load)) {return false;}
+        _logged[index] = true;
+        _last[index] = value;
+        return true;
+    }
+
+    /// audio callback side
+
+    // queues a record without waiting, it is counted as dropped if the queue is full
+    void logAudio(const TelemetryRecord& record)
+    {
+        if (!_audio.push(record)) {_audio_dropped.fetch_add(1, std::memory_order_relaxed);}
+    }
+
+    /// control loop side
+
+    // once flush_interval has passed since the last flush, formats up to MAX_LINES queued records and calls print(line) for each
+    // returns number of lines printed
+    template <typename Print>
+    int flush(uint32_t time, Print print)
+    {
+        if (time - _last_flush < _flush_interval) {return 0;}
+        _last_flush = time;
+
+        char line[LINE_SIZE]{};
+        int lines {0};
+        TelemetryRecord record{};
+        // audio events go first so overruns aren't held back by a burst of control changes
+        while (lines < MAX_LINES && (_audio.pop(record) || _control.pop(record)))
+        {
+            format(record, line);
+            print(static_cast<const char*>(line));
+            lines++;
+        }
+        const uint32_t dropped {_audio_dropped.load(std::memory_order_relaxed) + _control_dropped};
+        if (dropped != _reported_dropped && lines < MAX_LINES)
+        {
+            std::snprintf(line, LINE_SIZE, "dropped:%lu", static_cast<unsigned long>(dropped));
+            print(static_cast<const char*>(line));
+            _reported_dropped = dropped;
+            lines++;
+        }
+        return lines;
+    }
+    // returns number of records dropped because a queue was full
+    uint32_t getDropped() const {return _audio_dropped.load(std::memory_order_relaxed) + _control_dropped;}
+
+private:
+    static constexpr int ID_COUNT{static_cast<int>(TelemetryId::COUNT)};
+
+    SpscQueue<TelemetryRecord, QUEUE_SIZE> _control{};  //> filled by the control loop
+    SpscQueue<TelemetryRecord, QUEUE_SIZE> _audio{};    //> filled by the audio callback
+    std::atomic<uint32_t> _audio_dropped{0};
+    uint32_t _control_dropped{};
+    uint32_t _reported_dropped{};   //> drop count printed by the last flush
+    uint32_t _flush_interval{};
+    uint32_t _last_flush{};
+    float _last[ID_COUNT]{};        //> last value logged by logChange
+    bool _logged[ID_COUNT]{};       //> true once logChange has logged an id
+
+    // writes record as text, values are printed in fixed point so no float formatting is needed
+    static void format(const TelemetryRecord& record, char* line)
+    {
+        const long milli {static_cast<long>(record.value * 1000.0f)};
+        const long load {static_cast<long>(record.load * 100.0f + 0.5f)};
+        std::snprintf(line, LINE_SIZE, "%lu.%03lu %s:%s%ld.%03ld load:%ld%%",
+            static_cast<unsigned long>(record.time / 1000), static_cast<unsigned long>(record.time % 1000),
+            telemetryName(record.id), milli < 0 ? "-" : "", std::labs(milli) / 1000, std::labs(milli) % 1000, load);
+    }
+};
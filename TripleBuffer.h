@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer, single consumer handoff of a value using three slots.
+// The producer fills its back slot and publishes it, the consumer picks up the latest published slot.
+// Neither side waits and the consumer never sees a partly written value, it may skip values published in between.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() {}
+
+    /// producer side
+
+    // returns slot to fill, it holds stale data so every field must be written before publish
+    T& write() {return _slots[_back];}
+    // makes the written slot the latest value
+    void publish() {_back = _middle.exchange(static_cast<uint8_t>(_back | DIRTY), std::memory_order_acq_rel) & INDEX;}
+
+    /// consumer side
+
+    // takes the latest published value if there is one, returns true if read() changed
+    bool update()
+    {
+        if ((_middle.load(std::memory_order_relaxed) & DIRTY) == 0) {return false;}
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    // returns the value taken by the last update
+    const T& read() const {return _slots[_front];}
+
+private:
+    static constexpr uint8_t INDEX{3};  //> bits holding a slot index
+    static constexpr uint8_t DIRTY{4};  //> set on the middle slot when it holds a value the consumer hasn't taken
+
+    T _slots[3]{};
+    uint8_t _back{0};                   //> owned by producer
+    std::atomic<uint8_t> _middle{1};    //> swapped by both sides
+    uint8_t _front{2};                  //> owned by consumer
+};
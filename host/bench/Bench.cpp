@@ -0,0 +1,72 @@
+#include "Bench.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void BenchInput::init(size_t frames, int sample_rate)
+{
+    left.assign(frames, 0.0f);
+    right.assign(frames, 0.0f);
+    // plucked tone bursts every quarter second so delay lines carry signal, with silence between
+    const size_t burst_period {static_cast<size_t>(sample_rate / 4)};
+    const float phase_inc {220.0f / static_cast<float>(sample_rate)};
+    for (size_t i{0}; i < frames; i++)
+    {
+        const float env {std::exp(-static_cast<float>(i % burst_period) / (0.02f * static_cast<float>(sample_rate)))};
+        const float tone {std::sin(6.2831853f * phase_inc * static_cast<float>(i))};
+        left[i] = tone * env * 0.5f;
+        right[i] = left[i];
+    }
+}
+
+bool suiteEnabled(const BenchOptions& options, const char* suite)
+{
+    return options.suite == nullptr || std::strcmp(options.suite, suite) == 0;
+}
+
+void printHeader()
+{
+    std::printf("%-8s %6s  %-24s %12s %16s %14s\n", "suite", "voices", "config", "ns/sample", "samples/sec", "checksum");
+}
+
+void printRow(const char* suite, int voices, const char* config, const BenchResult& result)
+{
+    std::printf("%-8s %6d  %-24s %12.1f %16.0f %14.4g\n", suite, voices, config, result.ns_per_sample, result.samples_per_sec, static_cast<double>(result.checksum));
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options{};
+    for (int i{1}; i < argc; i++)
+    {
+        const bool has_value {i + 1 < argc};
+        if (has_value && std::strcmp(argv[i], "--seconds") == 0) {options.seconds = std::strtof(argv[++i], nullptr);}
+        else if (has_value && std::strcmp(argv[i], "--block") == 0) {options.block_size = std::strtoul(argv[++i], nullptr, 10);}
+        else if (has_value && std::strcmp(argv[i], "--max-voices") == 0) {options.max_voices = std::atoi(argv[++i]);}
+        else if (has_value && std::strcmp(argv[i], "--suite") == 0) {options.suite = argv[++i];}
+        else if (has_value && std::strcmp(argv[i], "--control-interval") == 0) {options.control_interval = std::atoi(argv[++i]);}
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--seconds s] [--block frames] [--max-voices n] [--suite name] [--control-interval samples]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.block_size == 0 || options.max_voices < 1 || options.seconds <= 0.0f || options.control_interval < 1)
+    {
+        std::fprintf(stderr, "block, max voices, seconds and control interval must be positive\n");
+        return 1;
+    }
+
+    BenchInput input{};
+    input.init(static_cast<size_t>(options.seconds * static_cast<float>(options.sample_rate)), options.sample_rate);
+
+    std::printf("%.2f s per case at %d Hz, %zu frame blocks, modulation every %d samples\n",
+        static_cast<double>(options.seconds), options.sample_rate, options.block_size, options.control_interval);
+    printHeader();
+    runEngineBench(options, input);
+    runPhaseBench(options, input);
+    runProfileBench(options, input);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// options shared by every benchmark case
+struct BenchOptions
+{
+    int sample_rate{48000};
+    float seconds{2.0f};        //> length of audio rendered per case, read heads slew in from max delay during the first second
+    size_t block_size{4};       //> frames per process call, firmware runs blocks of 4
+    int max_voices{64};         //> voice counts are doubled from 1 up to this value
+    int control_interval{16};   //> samples between flutter and pan updates, 1 matches per sample modulation
+    const char* suite{};        //> when set only suites with this name run
+};
+
+// timing of a single benchmark case
+struct BenchResult
+{
+    double ns_per_sample{};     //> nanoseconds per stereo frame
+    double samples_per_sec{};   //> stereo frames rendered per second
+    float checksum{};           //> sum of output, printed so the work can't be optimized away
+};
+
+// deterministic test signal used as input for every case
+struct BenchInput
+{
+    std::vector<float> left{};
+    std::vector<float> right{};
+
+    void init(size_t frames, int sample_rate);
+    size_t size() const {return left.size();}
+};
+
+// calls process(offset, frames) over the whole input in blocks and times it
+template <typename Process>
+BenchResult timeBlocks(size_t total_frames, size_t block_size, Process process)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start {Clock::now()};
+    float checksum{0.0f};
+    for (size_t offset{0}; offset < total_frames; offset += block_size)
+    {
+        const size_t frames {total_frames - offset < block_size ? total_frames - offset : block_size};
+        checksum += process(offset, frames);
+    }
+    const double ns {static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count())};
+
+    BenchResult result{};
+    result.ns_per_sample = ns / static_cast<double>(total_frames);
+    result.samples_per_sec = ns > 0.0 ? static_cast<double>(total_frames) * 1.0e9 / ns : 0.0;
+    result.checksum = checksum;
+    return result;
+}
+
+// returns true if the named suite was selected on the command line
+bool suiteEnabled(const BenchOptions& options, const char* suite);
+// prints column names for result rows
+void printHeader();
+// prints a single result row, config is a short description of enabled features
+void printRow(const char* suite, int voices, const char* config, const BenchResult& result);
+
+// benchmark suites
+void runEngineBench(const BenchOptions& options, const BenchInput& input);
+void runPhaseBench(const BenchOptions& options, const BenchInput& input);
+// per stage timing of the firmware signal path, run with --suite profile on a DELAY_PROFILE=1 build
+void runProfileBench(const BenchOptions& options, const BenchInput& input);
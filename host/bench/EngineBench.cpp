@@ -0,0 +1,482 @@
+#include "Bench.h"
+#include "DelayEngine.h"
+#include "FixedDelayEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+// engine configuration benchmarked as one suite
+struct EngineSuite
+{
+    const char* name{};
+    DelayEngine::Layout layout{};
+    RingMode ring_mode{};
+    SampleFormat format{};
+};
+
+// sample rate and max delay of the fixed engine suite, these must be compile time constants
+constexpr int FIXED_SAMPLE_RATE{48000};
+constexpr int FIXED_MAX_DELAY{FIXED_SAMPLE_RATE * 2};
+
+// spreads voices across ratios and pans, then times the engine over the whole input
+template <typename Engine>
+BenchResult runEngine(Engine& engine, const BenchOptions& options, const BenchInput& input, int voices, bool flutter, bool ping_pong, bool detune)
+{
+    engine.setControlInterval(options.control_interval);
+    for (int voice_id{0}; voice_id < voices; voice_id++)
+    {
+        const float spread {voices > 1 ? static_cast<float>(voice_id) / static_cast<float>(voices - 1) : 0.5f};
+        engine.setPan(voice_id, spread);
+        engine.setDelayRatio(voice_id, 0.3f + 0.7f * spread);
+        if (detune) {engine.setDetune(voice_id, -300.0f);}
+    }
+    engine.setMasterDelayTime(0.1f * static_cast<float>(options.sample_rate));
+    engine.setMasterFeedback(0.5f);
+    engine.setMasterFlutter(flutter ? 0.5f : 0.0f);
+    engine.setPingPongMode(ping_pong);
+
+    std::vector<float> out_left(options.block_size);
+    std::vector<float> out_right(options.block_size);
+    return timeBlocks(input.size(), options.block_size, [&](size_t offset, size_t frames)
+    {
+        engine.process(input.left.data() + offset, input.right.data() + offset, out_left.data(), out_right.data(), frames);
+        float sum{0.0f};
+        for (size_t i{0}; i < frames; i++) {sum += out_left[i] + out_right[i];}
+        return sum;
+    });
+}
+
+// runs a full engine with voices spread across ratios and pans
+template <typename Sample>
+BenchResult benchEngine(const BenchOptions& options, const BenchInput& input, const EngineSuite& suite, int voices, bool flutter, bool ping_pong, bool detune)
+{
+    const int max_delay {options.sample_rate * 2};
+    const size_t buffer_size {static_cast<size_t>(DelayEngine::bufferSize(max_delay, voices, suite.layout, suite.ring_mode))};
+    std::vector<Sample> left_buffer(buffer_size);
+    std::vector<Sample> right_buffer(buffer_size);
+    DelayEngine engine{};
+    engine.init(left_buffer.data(), right_buffer.data(), max_delay, voices, options.sample_rate, suite.layout, suite.ring_mode);
+    return runEngine(engine, options, input, voices, flutter, ping_pong, detune);
+}
+
+// runs the packed power of two engine with the given interpolation
+BenchResult benchInterpolation(const BenchOptions& options, const BenchInput& input, Interpolation interpolation, int voices, bool flutter, bool ping_pong, bool detune)
+{
+    const int max_delay {options.sample_rate * 2};
+    const size_t buffer_size {static_cast<size_t>(DelayEngine::bufferSize(max_delay, voices, DelayEngine::Layout::PACKED, RingMode::POWER_OF_TWO))};
+    std::vector<float> left_buffer(buffer_size);
+    std::vector<float> right_buffer(buffer_size);
+    DelayEngine engine{};
+    engine.init(left_buffer.data(), right_buffer.data(), max_delay, voices, options.sample_rate, DelayEngine::Layout::PACKED, RingMode::POWER_OF_TWO);
+    engine.setInterpolation(interpolation);
+    return runEngine(engine, options, input, voices, flutter, ping_pong, detune);
+}
+
+// runs an engine over a phrase followed by silence, with voice sleep on or off
+BenchResult benchSleep(const BenchOptions& options, const BenchInput& input, DelayEngine::Layout layout, int voices, bool sleep)
+{
+    const int max_delay {options.sample_rate * 2};
+    const size_t buffer_size {static_cast<size_t>(DelayEngine::bufferSize(max_delay, voices, layout, RingMode::POWER_OF_TWO))};
+    std::vector<float> left_buffer(buffer_size);
+    std::vector<float> right_buffer(buffer_size);
+    DelayEngine engine{};
+    engine.init(left_buffer.data(), right_buffer.data(), max_delay, voices, options.sample_rate, layout, RingMode::POWER_OF_TWO);
+    engine.setSleep(sleep);
+    return runEngine(engine, options, input, voices, true, false, false);
+}
+
+// runs packed2 in a block mode with host blocks of the mode's sub-block size, flutter and ping pong on
+BenchResult benchBlockMode(const BenchOptions& options, const BenchInput& input, BlockMode mode, int voices)
+{
+    BenchOptions mode_options {options};
+    mode_options.block_size = static_cast<size_t>(blockModeFrames(mode));
+    mode_options.control_interval = blockModeInterval(mode);
+    const int max_delay {options.sample_rate * 2};
+    const size_t buffer_size {static_cast<size_t>(DelayEngine::bufferSize(max_delay, voices, DelayEngine::Layout::PACKED, RingMode::POWER_OF_TWO))};
+    std::vector<float> left_buffer(buffer_size);
+    std::vector<float> right_buffer(buffer_size);
+    DelayEngine engine{};
+    engine.init(left_buffer.data(), right_buffer.data(), max_delay, voices, options.sample_rate, DelayEngine::Layout::PACKED, RingMode::POWER_OF_TWO);
+    engine.setBlockMode(mode);
+    return runEngine(engine, mode_options, input, voices, true, true, false);
+}
+
+// runs the compile time configured engine, same setup as packed2
+template <int VOICES>
+BenchResult benchFixed(const BenchOptions& options, const BenchInput& input, bool flutter, bool ping_pong, bool detune)
+{
+    using Engine = FixedDelayEngine<VOICES, FIXED_MAX_DELAY, FIXED_SAMPLE_RATE>;
+    // host memory has a single tier, separate arenas stand in for on-chip and SDRAM memory
+    // vectors aren't cache line aligned, so leave room for the arena to align the first buffer
+    std::vector<uint8_t> fast_storage(DelayMemory::stereoSize(DelayMemory::DEFAULT_FAST_LIMIT) + DelayMemory::ALIGNMENT);
+    std::vector<uint8_t> bulk_storage(Engine::memorySize() + DelayMemory::ALIGNMENT);
+    DelayMemory memory{};
+    memory.init(fast_storage.data(), fast_storage.size(), bulk_storage.data(), bulk_storage.size());
+    // engine holds its parameters inline, keep it off the stack for large voice counts
+    std::vector<Engine> engine(1);
+    if (!engine[0].init(memory)) {return BenchResult{};}
+    return runEngine(engine[0], options, input, VOICES, flutter, ping_pong, detune);
+}
+
+// voice counts are template arguments, so each one benchmarked needs its own instantiation
+BenchResult benchFixed(const BenchOptions& options, const BenchInput& input, int voices, bool flutter, bool ping_pong, bool detune)
+{
+    switch (voices)
+    {
+    case 1: return benchFixed<1>(options, input, flutter, ping_pong, detune);
+    case 2: return benchFixed<2>(options, input, flutter, ping_pong, detune);
+    case 4: return benchFixed<4>(options, input, flutter, ping_pong, detune);
+    case 8: return benchFixed<8>(options, input, flutter, ping_pong, detune);
+    case 16: return benchFixed<16>(options, input, flutter, ping_pong, detune);
+    case 32: return benchFixed<32>(options, input, flutter, ping_pong, detune);
+    default: return benchFixed<64>(options, input, flutter, ping_pong, detune);
+    }
+}
+
+// returns rms of the flutter noise a bank of voices makes when updated every interval samples
+// runs at least 10 s so the estimate is within about 1%
+double flutterDepth(const BenchOptions& options, int interval)
+{
+    constexpr int VOICES{16};
+    uint32_t state[VOICES]{};
+    float low[VOICES]{};
+    float band[VOICES]{};
+    float noise[VOICES]{};
+    FlutterNoiseBank bank{};
+    bank.init(state, low, band, noise, VOICES);
+    bank.setRate(options.sample_rate, interval);
+    bank.reset(NOISE_SEED);
+    const int steps {static_cast<int>(std::max(options.seconds, 10.0f) * static_cast<float>(options.sample_rate)) / interval};
+    double sum {0.0};
+    for (int step{0}; step < steps; step++)
+    {
+        bank.process();
+        for (int voice_id{0}; voice_id < VOICES; voice_id++) {sum += static_cast<double>(bank.get(voice_id)) * bank.get(voice_id);}
+    }
+    return std::sqrt(sum / (static_cast<double>(steps) * VOICES));
+}
+
+// returns largest output difference when the bypassed upper half of an engine's voices get other delay ratios
+// a bypassed voice must not be heard at all, so its ratio can't change the output in any layout
+// skipped is set to the voices that skipped processing at the end
+float bypassLeak(const BenchOptions& options, const BenchInput& input, DelayEngine::Layout layout, int voices, int& skipped)
+{
+    const int max_delay {options.sample_rate * 2};
+    const size_t buffer_size {static_cast<size_t>(DelayEngine::bufferSize(max_delay, voices, layout, RingMode::POWER_OF_TWO))};
+    std::vector<float> out[2][2] {};
+    for (int run{0}; run < 2; run++)
+    {
+        std::vector<float> left_buffer(buffer_size);
+        std::vector<float> right_buffer(buffer_size);
+        DelayEngine engine{};
+        engine.init(left_buffer.data(), right_buffer.data(), max_delay, voices, options.sample_rate, layout, RingMode::POWER_OF_TWO);
+        for (int voice_id{0}; voice_id < voices; voice_id++)
+        {
+            const bool bypass {voice_id >= voices / 2};
+            engine.setDelayRatio(voice_id, bypass && run == 1 ? 0.13f : 0.3f + 0.7f * static_cast<float>(voice_id) / static_cast<float>(voices));
+            engine.setBypass(voice_id, bypass);
+        }
+        engine.setMasterDelayTime(0.1f * static_cast<float>(options.sample_rate));
+        engine.setMasterFeedback(0.8f);
+        out[run][0].resize(input.size());
+        out[run][1].resize(input.size());
+        for (size_t offset{0}; offset < input.size(); offset += options.block_size)
+        {
+            const size_t frames {std::min(options.block_size, input.size() - offset)};
+            engine.process(input.left.data() + offset, input.right.data() + offset, out[run][0].data() + offset, out[run][1].data() + offset, frames);
+        }
+        skipped = engine.getSleepingVoices();
+    }
+    float leak {0.0f};
+    for (size_t i{0}; i < input.size(); i++)
+    {
+        leak = std::max(leak, std::max(std::abs(out[0][0][i] - out[1][0][i]), std::abs(out[0][1][i] - out[1][1][i])));
+    }
+    return leak;
+}
+
+// frames per process call of the preset check, like the pedal's audio callback
+constexpr size_t PRESET_BLOCK{64};
+// frames the preset check morphs over
+constexpr int PRESET_MORPH_FRAMES{4800};
+
+// counts process calls until the engine's last recall or morph has finished, gives up after limit calls
+template <typename Engine>
+int runPreset(Engine& engine, const BenchInput& input, int limit)
+{
+    float out_left[PRESET_BLOCK]{};
+    float out_right[PRESET_BLOCK]{};
+    int calls {0};
+    while (engine.getMorphing() && calls < limit)
+    {
+        const size_t offset {(static_cast<size_t>(calls) * PRESET_BLOCK) % (input.size() - PRESET_BLOCK)};
+        engine.process(input.left.data() + offset, input.right.data() + offset, out_left, out_right, PRESET_BLOCK);
+        calls++;
+    }
+    return calls;
+}
+
+// returns true if the voice values of a captured preset match to
+bool presetVoicesMatch(const DelayPreset& captured, const DelayPreset& to, int voices)
+{
+    for (int voice_id{0}; voice_id < std::min(voices, DelayPreset::MAX_VOICES); voice_id++)
+    {
+        if (captured.ratio[voice_id] != to.ratio[voice_id] || captured.pan[voice_id] != to.pan[voice_id] || captured.detune[voice_id] != to.detune[voice_id]) {return false;}
+    }
+    return true;
+}
+
+// recalls a preset, then morphs to another and sets feedback halfway through
+// recall_calls and morph_calls are set to the process calls each took, returns true if the engine ended on the expected values
+template <typename Engine>
+bool checkPresets(Engine& engine, const BenchInput& input, int voices, int& recall_calls, int& morph_calls)
+{
+    DelayPreset first{};
+    DelayPreset second{};
+    for (int voice_id{0}; voice_id < std::min(voices, DelayPreset::MAX_VOICES); voice_id++)
+    {
+        const float spread {static_cast<float>(voice_id) / static_cast<float>(voices)};
+        first.ratio[voice_id] = 0.2f + 0.5f * spread;
+        first.pan[voice_id] = spread;
+        first.detune[voice_id] = -100.0f;
+        second.ratio[voice_id] = 0.9f - 0.5f * spread;
+        second.pan[voice_id] = 1.0f - spread;
+        second.detune[voice_id] = -300.0f * spread;
+    }
+    first.controls = {12000.0f, 0.3f, 0.2f, 0, true};
+    second.controls = {24000.0f, 0.6f, 0.1f, 1, false};
+
+    DelayPreset captured{};
+    engine.recall(&first);
+    recall_calls = runPreset(engine, input, PRESET_MORPH_FRAMES);
+    engine.capture(captured);
+    const bool recalled {presetVoicesMatch(captured, first, voices) && captured.controls.master_delay_time == first.controls.master_delay_time};
+
+    engine.morph(&first, &second, PRESET_MORPH_FRAMES);
+    morph_calls = runPreset(engine, input, 10);
+    // a control set during the morph is applied once it ends
+    engine.setMasterFeedback(0.9f);
+    morph_calls += runPreset(engine, input, PRESET_MORPH_FRAMES);
+    engine.capture(captured);
+    return recalled && presetVoicesMatch(captured, second, voices) && captured.controls.master_delay_time == second.controls.master_delay_time
+        && captured.controls.master_feedback == 0.9f && captured.controls.bypass_mask == second.controls.bypass_mask && !captured.controls.ping_pong;
+}
+
+// prints one row of the preset check, the morph takes whole sub-blocks and the first one starts with the first call
+void printPresetRow(const char* name, int voices, BlockMode mode, bool matched, int recall_calls, int morph_calls)
+{
+    const int block_frames {blockModeFrames(mode)};
+    const int expected {(presetBlocks(PRESET_MORPH_FRAMES, block_frames) * block_frames + static_cast<int>(PRESET_BLOCK) - 1) / static_cast<int>(PRESET_BLOCK)};
+    const bool ok {matched && recall_calls == 1 && morph_calls == expected};
+    std::printf("%-8s %-16s %8d %8d %8d %8d  %s\n", "preset", name, voices, recall_calls, morph_calls, expected, ok ? "ok" : "FAILED");
+}
+
+// checks preset recall and morph on an engine of a layout
+void benchPresets(const BenchOptions& options, const BenchInput& input, const char* name, DelayEngine::Layout layout, int voices, BlockMode mode)
+{
+    const int max_delay {options.sample_rate * 2};
+    const size_t buffer_size {static_cast<size_t>(DelayEngine::bufferSize(max_delay, voices, layout, RingMode::POWER_OF_TWO))};
+    std::vector<float> left_buffer(buffer_size);
+    std::vector<float> right_buffer(buffer_size);
+    DelayEngine engine{};
+    engine.init(left_buffer.data(), right_buffer.data(), max_delay, voices, options.sample_rate, layout, RingMode::POWER_OF_TWO);
+    engine.setBlockMode(mode);
+    int recall_calls {0};
+    int morph_calls {0};
+    const bool matched {checkPresets(engine, input, voices, recall_calls, morph_calls)};
+    printPresetRow(name, voices, mode, matched, recall_calls, morph_calls);
+}
+
+// checks preset recall and morph on the compile time configured engine
+template <int VOICES>
+void benchFixedPresets(const BenchInput& input, BlockMode mode)
+{
+    using Engine = FixedDelayEngine<VOICES, FIXED_MAX_DELAY, FIXED_SAMPLE_RATE>;
+    std::vector<float> left_buffer(Engine::bufferSize());
+    std::vector<float> right_buffer(Engine::bufferSize());
+    std::unique_ptr<Engine> engine {new Engine{}};
+    engine->init(left_buffer.data(), right_buffer.data());
+    engine->setBlockMode(mode);
+    int recall_calls {0};
+    int morph_calls {0};
+    const bool matched {checkPresets(*engine, input, VOICES, recall_calls, morph_calls)};
+    printPresetRow("fixed", VOICES, mode, matched, recall_calls, morph_calls);
+}
+
+// prints every combination of flutter, ping pong and detune for one voice count
+template <typename Bench>
+void runConfigs(const char* suite, int voices, Bench bench)
+{
+    for (int config{0}; config < 8; config++)
+    {
+        const bool flutter {(config & 1) != 0};
+        const bool ping_pong {(config & 2) != 0};
+        const bool detune {(config & 4) != 0};
+        char name[32]{};
+        std::snprintf(name, sizeof(name), "flt:%d png:%d det:%d", flutter, ping_pong, detune);
+        printRow(suite, voices, name, bench(flutter, ping_pong, detune));
+    }
+}
+} // namespace
+
+void runEngineBench(const BenchOptions& options, const BenchInput& input)
+{
+    const EngineSuite suites[] {
+        {"voices", DelayEngine::Layout::VOICES, RingMode::EXACT, SampleFormat::FLOAT},
+        {"packed", DelayEngine::Layout::PACKED, RingMode::EXACT, SampleFormat::FLOAT},
+        {"voices2", DelayEngine::Layout::VOICES, RingMode::POWER_OF_TWO, SampleFormat::FLOAT},
+        {"packed2", DelayEngine::Layout::PACKED, RingMode::POWER_OF_TWO, SampleFormat::FLOAT},
+        {"voices2q", DelayEngine::Layout::VOICES, RingMode::POWER_OF_TWO, SampleFormat::Q15},
+        {"packed2q", DelayEngine::Layout::PACKED, RingMode::POWER_OF_TWO, SampleFormat::Q15},
+        {"taps", DelayEngine::Layout::TAPS, RingMode::EXACT, SampleFormat::FLOAT},
+        {"taps2", DelayEngine::Layout::TAPS, RingMode::POWER_OF_TWO, SampleFormat::FLOAT},
+        {"taps2q", DelayEngine::Layout::TAPS, RingMode::POWER_OF_TWO, SampleFormat::Q15},
+    };
+    for (const EngineSuite& suite : suites)
+    {
+        if (!suiteEnabled(options, suite.name)) {continue;}
+        for (int voices{1}; voices <= options.max_voices; voices *= 2)
+        {
+            runConfigs(suite.name, voices, [&](bool flutter, bool ping_pong, bool detune)
+            {
+                return suite.format == SampleFormat::Q15
+                    ? benchEngine<int16_t>(options, input, suite, voices, flutter, ping_pong, detune)
+                    : benchEngine<float>(options, input, suite, voices, flutter, ping_pong, detune);
+            });
+        }
+    }
+
+    // cost of each interpolation mode with flutter and detune on, like the chorus
+    if (suiteEnabled(options, "interp"))
+    {
+        const struct {const char* name; Interpolation interpolation;} modes[] {
+            {"nearest", Interpolation::NEAREST},
+            {"linear", Interpolation::LINEAR},
+            {"hermite", Interpolation::HERMITE},
+            {"allpass", Interpolation::ALLPASS},
+        };
+        for (int voices{1}; voices <= options.max_voices; voices *= 2)
+        {
+            for (const auto& mode : modes)
+            {
+                printRow("interp", voices, mode.name, benchInterpolation(options, input, mode.interpolation, voices, true, false, true));
+            }
+        }
+    }
+
+    // voices sleep once their tails decay, so play the first quarter of the input and then four times as much silence
+    if (suiteEnabled(options, "sleep"))
+    {
+        BenchInput phrase{};
+        phrase.left.assign(input.size() * 4, 0.0f);
+        phrase.right.assign(input.size() * 4, 0.0f);
+        std::copy(input.left.begin(), input.left.begin() + input.size() / 4, phrase.left.begin());
+        std::copy(input.right.begin(), input.right.begin() + input.size() / 4, phrase.right.begin());
+        const struct {const char* name; DelayEngine::Layout layout; bool sleep;} modes[] {
+            {"voices2 awake", DelayEngine::Layout::VOICES, false},
+            {"voices2 sleep", DelayEngine::Layout::VOICES, true},
+            {"packed2 awake", DelayEngine::Layout::PACKED, false},
+            {"packed2 sleep", DelayEngine::Layout::PACKED, true},
+        };
+        for (int voices{1}; voices <= options.max_voices; voices *= 2)
+        {
+            for (const auto& mode : modes)
+            {
+                printRow("sleep", voices, mode.name, benchSleep(options, phrase, mode.layout, voices, mode.sleep));
+            }
+        }
+    }
+
+    // cpu per frame of each block mode, the block size option is replaced by the mode's sub-block size
+    if (suiteEnabled(options, "block"))
+    {
+        const struct {const char* name; BlockMode mode;} modes[] {
+            {"low latency 4", BlockMode::LOW_LATENCY},
+            {"balanced 16", BlockMode::BALANCED},
+            {"efficient 48", BlockMode::EFFICIENT},
+            {"throughput 128", BlockMode::THROUGHPUT},
+        };
+        for (int voices{1}; voices <= options.max_voices; voices *= 2)
+        {
+            for (const auto& mode : modes)
+            {
+                printRow("block", voices, mode.name, benchBlockMode(options, input, mode.mode, voices));
+            }
+        }
+    }
+
+    // flutter depth must not depend on the block mode, compare each mode's modulation interval with the default one
+    if (suiteEnabled(options, "depth"))
+    {
+        const struct {const char* name; BlockMode mode;} modes[] {
+            {"low latency 4", BlockMode::LOW_LATENCY},
+            {"balanced 16", BlockMode::BALANCED},
+            {"efficient 48", BlockMode::EFFICIENT},
+            {"throughput 128", BlockMode::THROUGHPUT},
+        };
+        const double reference {flutterDepth(options, CONTROL_INTERVAL)};
+        std::printf("%-8s %-16s %8s %10s %8s  %s\n", "suite", "mode", "interval", "rms", "ratio", "result");
+        for (const auto& mode : modes)
+        {
+            const int interval {blockModeInterval(mode.mode)};
+            const double ratio {flutterDepth(options, interval) / reference};
+            std::printf("%-8s %-16s %8d %10.4f %8.3f  %s\n", "depth", mode.name, interval, ratio * reference, ratio,
+                std::abs(ratio - 1.0) < 0.05 ? "ok" : "CHANGED");
+        }
+    }
+
+    // bypassed voices must be silent in every layout, taps on a shared line included, and skip processing while sleep is on
+    if (suiteEnabled(options, "bypass"))
+    {
+        const struct {const char* name; DelayEngine::Layout layout;} layouts[] {
+            {"voices2", DelayEngine::Layout::VOICES},
+            {"packed2", DelayEngine::Layout::PACKED},
+            {"taps2", DelayEngine::Layout::TAPS},
+        };
+        std::printf("%-8s %-16s %8s %8s %10s  %s\n", "suite", "layout", "voices", "skipped", "leak", "result");
+        for (int voices{2}; voices <= options.max_voices && voices <= DelayControls::MAX_BYPASS_VOICES; voices *= 2)
+        {
+            for (const auto& layout : layouts)
+            {
+                int skipped {0};
+                const float leak {bypassLeak(options, input, layout.layout, voices, skipped)};
+                std::printf("%-8s %-16s %8d %8d %10.6f  %s\n", "bypass", layout.name, voices, skipped, leak, leak == 0.0f ? "ok" : "LEAKS");
+            }
+        }
+    }
+
+    // recall lands on the next block and a morph takes its frames rounded up to sub-blocks, in every layout and the fixed engine
+    if (suiteEnabled(options, "preset") && options.sample_rate == FIXED_SAMPLE_RATE)
+    {
+        const struct {const char* name; DelayEngine::Layout layout;} layouts[] {
+            {"voices2", DelayEngine::Layout::VOICES},
+            {"packed2", DelayEngine::Layout::PACKED},
+            {"taps2", DelayEngine::Layout::TAPS},
+        };
+        std::printf("%-8s %-16s %8s %8s %8s %8s  %s\n", "suite", "engine", "voices", "recall", "morph", "expected", "result");
+        for (BlockMode mode : {BlockMode::LOW_LATENCY, BlockMode::THROUGHPUT})
+        {
+            for (const auto& layout : layouts)
+            {
+                benchPresets(options, input, layout.name, layout.layout, 8, mode);
+            }
+            benchFixedPresets<4>(input, mode);
+        }
+    }
+
+    // compile time sized engine, only instantiated up to 64 voices and at 48kHz
+    if (suiteEnabled(options, "fixed") && options.sample_rate == FIXED_SAMPLE_RATE)
+    {
+        for (int voices{1}; voices <= options.max_voices && voices <= 64; voices *= 2)
+        {
+            runConfigs("fixed", voices, [&](bool flutter, bool ping_pong, bool detune)
+            {
+                return benchFixed(options, input, voices, flutter, ping_pong, detune);
+            });
+        }
+    }
+}
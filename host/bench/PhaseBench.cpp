@@ -0,0 +1,49 @@
+#include "Bench.h"
+#include "DelayPhase.h"
+
+#include <memory>
+
+namespace
+{
+constexpr int SAMPLE_RATE{48000};
+constexpr int MAX_DELAY{SAMPLE_RATE * 2};
+constexpr int MAX_VOICES{64};
+using Phase = DelayPhase<MAX_DELAY, SAMPLE_RATE, MAX_VOICES>;
+
+// DelayPhase only takes mono input one sample at a time
+// with churn the oldest voice is deleted and a new one added every block, like voices changed during a performance
+BenchResult benchPhase(const BenchOptions& options, const BenchInput& input, int voices, bool churn)
+{
+    std::vector<float> buffer(static_cast<size_t>(MAX_DELAY) * voices);
+    std::unique_ptr<Phase> phase {new Phase{}};
+    phase->init(buffer.data(), static_cast<int>(buffer.size()));
+    for (int voice_id{0}; voice_id < voices; voice_id++) {phase->addVoice();}
+    phase->setMasterDelay(0.25f);
+
+    return timeBlocks(input.size(), options.block_size, [&](size_t offset, size_t frames)
+    {
+        if (churn)
+        {
+            phase->deleteVoice(phase->getVoiceId(0));
+            phase->addVoice();
+        }
+        float sum{0.0f};
+        for (size_t i{0}; i < frames; i++)
+        {
+            phase->process(input.left[offset + i]);
+            sum += phase->getLeft() + phase->getRight();
+        }
+        return sum;
+    });
+}
+} // namespace
+
+void runPhaseBench(const BenchOptions& options, const BenchInput& input)
+{
+    if (options.sample_rate != SAMPLE_RATE || !suiteEnabled(options, "phase")) {return;}
+    for (int voices{1}; voices <= options.max_voices && voices <= MAX_VOICES; voices *= 2)
+    {
+        printRow("phase", voices, "flt:1", benchPhase(options, input, voices, false));
+        printRow("phase", voices, "flt:1 churn", benchPhase(options, input, voices, true));
+    }
+}
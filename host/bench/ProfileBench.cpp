@@ -0,0 +1,74 @@
+#include "Bench.h"
+#include "DelayProfiler.h"
+#include "Effects.h"
+
+#include <cstdio>
+
+namespace
+{
+// renders the delay and chorus of Effects.h block by block with each stage timed like the audio callback
+void profileEffects(const BenchOptions& options, const BenchInput& input)
+{
+    std::vector<uint8_t> fast_storage(ChorusEffect::memorySize(CHORUS_RATIOS) + DelayMemory::ALIGNMENT);
+    std::vector<uint8_t> bulk_storage(DelayEffect::memorySize(DELAY_RATIOS) + DelayMemory::ALIGNMENT);
+    DelayMemory memory{};
+    memory.init(fast_storage.data(), fast_storage.size(), bulk_storage.data(), bulk_storage.size());
+    std::vector<DelayEffect> delay(1);
+    std::vector<ChorusEffect> chorus(1);
+    if (!delay[0].init(memory, DELAY_RATIOS) || !chorus[0].init(memory, CHORUS_RATIOS)) {return;}
+    setupDelay(delay[0]);
+    setupChorus(chorus[0]);
+    delay[0].setControlInterval(options.control_interval);
+    delay[0].setMasterDelayTime(0.1f * static_cast<float>(SAMPLE_RATE));
+    delay[0].setMasterFeedback(0.5f);
+    delay[0].setMasterFlutter(0.5f);
+    chorus[0].setControlInterval(options.control_interval);
+
+    // a single report covers the whole input
+    const size_t blocks {(input.size() + options.block_size - 1) / options.block_size};
+    delayProfiler().init(static_cast<float>(options.sample_rate), options.block_size, static_cast<int>(blocks));
+    std::vector<float> wet_left(options.block_size);
+    std::vector<float> wet_right(options.block_size);
+    std::vector<float> chorus_left(options.block_size);
+    std::vector<float> chorus_right(options.block_size);
+    timeBlocks(input.size(), options.block_size, [&](size_t offset, size_t frames)
+    {
+        DELAY_PROFILE_BLOCK();
+        {
+            DELAY_PROFILE_SCOPE(DELAY);
+            delay[0].process(input.left.data() + offset, input.right.data() + offset, wet_left.data(), wet_right.data(), frames);
+        }
+        {
+            DELAY_PROFILE_SCOPE(CHORUS);
+            chorus[0].process(wet_left.data(), wet_right.data(), chorus_left.data(), chorus_right.data(), frames);
+        }
+        return chorus_left[0];
+    });
+    if (!delayProfiler().update()) {return;}
+
+    const ProfileReport& report {delayProfiler().read()};
+    std::printf("\n%-14s %10s %10s %10s %10s   ns per block, block budget %.0f ns\n", "stage", "blocks", "min", "mean", "max", static_cast<double>(report.budget));
+    for (int stage{0}; stage < static_cast<int>(ProfileStage::COUNT); stage++)
+    {
+        const ProfileStats& stats {report.stages[stage]};
+        std::printf("%-14s %10u %10u %10.1f %10u\n", profileStageName(static_cast<ProfileStage>(stage)), stats.count, stats.min, static_cast<double>(stats.mean()),
+            stats.max);
+    }
+    const ProfileStats& callback {report.stage(ProfileStage::CALLBACK)};
+    std::printf("callback load:");
+    for (int bin{0}; bin < ProfileStats::LOAD_BINS - 1; bin++) {std::printf(" <%d%%:%u", (bin + 1) * 10, callback.load[bin]);}
+    std::printf(" over:%u\n", callback.load[ProfileStats::LOAD_BINS - 1]);
+}
+} // namespace
+
+void runProfileBench(const BenchOptions& options, const BenchInput& input)
+{
+    // only selected explicitly, the timers are compiled out unless built with DELAY_PROFILE=1
+    if (options.suite == nullptr || !suiteEnabled(options, "profile")) {return;}
+    if (!DELAY_PROFILE)
+    {
+        std::fprintf(stderr, "profile suite needs a build with OPT=\"-O2 -DDELAY_PROFILE=1\"\n");
+        return;
+    }
+    profileEffects(options, input);
+}
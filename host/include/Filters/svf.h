@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// host stand-in for daisysp::Svf, double sampled chamberlin state variable filter
+namespace daisysp
+{
+class Svf
+{
+public:
+    Svf() {}
+    ~Svf() {}
+
+    void Init(float sample_rate)
+    {
+        _sr = sample_rate;
+        _fc_max = _sr / 3.0f;
+        _res = 0.5f;
+        _pre_drive = 0.5f;
+        _drive = _pre_drive * _res;
+        _low = _high = _band = _notch = 0.0f;
+        _out_low = _out_high = _out_band = _out_notch = 0.0f;
+        SetFreq(200.0f);
+    }
+
+    void Process(float in)
+    {
+        _out_low = _out_high = _out_band = _out_notch = 0.0f;
+        // two passes per sample keep the filter stable up to higher cutoffs
+        for (int pass{0}; pass < 2; pass++)
+        {
+            _notch = in - _damp * _band;
+            _low = _low + _freq * _band;
+            _high = _notch - _low;
+            _band = _freq * _high + _band - _drive * _band * _band * _band;
+            _out_low += 0.5f * _low;
+            _out_high += 0.5f * _high;
+            _out_band += 0.5f * _band;
+            _out_notch += 0.5f * _notch;
+        }
+    }
+
+    void SetFreq(float f)
+    {
+        _fc = std::min(std::max(f, 1.0e-6f), _fc_max);
+        _freq = 2.0f * std::sin(PI * std::min(0.25f, _fc / (_sr * 2.0f)));
+        updateDamp();
+    }
+    void SetRes(float r)
+    {
+        _res = std::min(std::max(r, 0.0f), 1.0f);
+        _drive = _pre_drive * _res;
+        updateDamp();
+    }
+    void SetDrive(float d)
+    {
+        _pre_drive = std::min(std::max(d, 0.0f), 1.0f);
+        _drive = _pre_drive * _res;
+    }
+
+    float Low() const {return _out_low;}
+    float High() const {return _out_high;}
+    float Band() const {return _out_band;}
+    float Notch() const {return _out_notch;}
+
+private:
+    static constexpr float PI{3.14159265358979323846f};
+
+    float _sr{};
+    float _fc{};
+    float _fc_max{};
+    float _res{};
+    float _drive{};
+    float _pre_drive{};
+    float _freq{};
+    float _damp{};
+    float _low{}, _high{}, _band{}, _notch{};
+    float _out_low{}, _out_high{}, _out_band{}, _out_notch{};
+
+    void updateDamp()
+    {
+        _damp = std::min(2.0f * (1.0f - std::pow(_res, 0.25f)), std::min(2.0f, 2.0f / _freq - _freq * 0.5f));
+    }
+};
+} // namespace daisysp
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// host stand-in for daisysp::WhiteNoise, same 16807 multiplicative generator
+namespace daisysp
+{
+class WhiteNoise
+{
+public:
+    WhiteNoise() {}
+    ~WhiteNoise() {}
+
+    void Init() {_seed = 1; _amp = 1.0f;}
+    void SetAmp(float a) {_amp = a;}
+    void SetSeed(int32_t s) {_seed = static_cast<uint32_t>(s);}
+
+    // returns noise in range -1.0f to 1.0f
+    float Process()
+    {
+        _seed *= 16807u;
+        return static_cast<float>(static_cast<int32_t>(_seed)) * COEFF * _amp;
+    }
+
+private:
+    static constexpr float COEFF{4.6566129e-010f};
+
+    uint32_t _seed{1};
+    float _amp{1.0f};
+};
+} // namespace daisysp
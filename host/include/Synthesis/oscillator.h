@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+
+// host stand-in for daisysp::Oscillator, only the sine waveform is implemented
+namespace daisysp
+{
+class Oscillator
+{
+public:
+    Oscillator() {}
+    ~Oscillator() {}
+
+    enum
+    {
+        WAVE_SIN,
+        WAVE_LAST,
+    };
+
+    void Init(float sample_rate)
+    {
+        _sr = sample_rate;
+        _sr_recip = 1.0f / sample_rate;
+        _freq = 100.0f;
+        _amp = 0.5f;
+        _phase = 0.0f;
+        _phase_inc = _freq * _sr_recip;
+        _waveform = WAVE_SIN;
+    }
+
+    float Process()
+    {
+        const float out {std::sin(_phase * TWO_PI)};
+        _phase += _phase_inc;
+        if (_phase >= 1.0f) {_phase -= 1.0f;}
+        return out * _amp;
+    }
+
+    void SetFreq(float f) {_freq = f; _phase_inc = _freq * _sr_recip;}
+    void SetAmp(float a) {_amp = a;}
+    void SetWaveform(unsigned char wf) {_waveform = wf < WAVE_LAST ? wf : static_cast<unsigned char>(WAVE_SIN);}
+    // adds phase offset in range 0.0f to 1.0f
+    void PhaseAdd(float phase) {_phase += phase; if (_phase >= 1.0f) {_phase -= std::floor(_phase);}}
+    void Reset(float phase = 0.0f) {_phase = phase;}
+
+private:
+    static constexpr float TWO_PI{6.28318530717958647692f};
+
+    float _sr{};
+    float _sr_recip{};
+    float _freq{};
+    float _amp{};
+    float _phase{};
+    float _phase_inc{};
+    unsigned char _waveform{};
+};
+} // namespace daisysp
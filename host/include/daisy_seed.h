@@ -0,0 +1,43 @@
+#pragma once
+
+// host stand-in for the libDaisy seed header, only simulated GPIO pins are available on the host
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+
+namespace daisy
+{
+// pin on the seed's header, ignored on the host
+struct Pin
+{
+    int port{};
+    int pin{};
+};
+
+// simulated digital pin, tests set the level an input reads with Write
+// the level is atomic so a test thread can drive pins that another thread samples
+class GPIO
+{
+public:
+    enum class Mode {INPUT, OUTPUT, OPEN_DRAIN, ANALOG};
+    enum class Pull {NOPULL, PULLUP, PULLDOWN};
+
+    GPIO() {}
+
+    // a pulled up pin reads high until it is driven
+    void Init(Pin pin, Mode mode = Mode::INPUT, Pull pull = Pull::NOPULL)
+    {
+        _pin = pin;
+        _mode = mode;
+        _level.store(pull == Pull::PULLUP, std::memory_order_relaxed);
+    }
+    bool Read() {return _level.load(std::memory_order_relaxed);}
+    void Write(bool state) {_level.store(state, std::memory_order_relaxed);}
+    void Toggle() {Write(!Read());}
+
+private:
+    Pin _pin{};
+    Mode _mode{Mode::INPUT};
+    std::atomic<bool> _level{false};
+};
+} // namespace daisy
@@ -0,0 +1,11 @@
+#pragma once
+
+// host stand-in for the DaisySP umbrella header, provides only the modules used by the delay dsp
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "Synthesis/oscillator.h"
+#include "Noise/whitenoise.h"
+#include "Filters/svf.h"
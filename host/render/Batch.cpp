@@ -0,0 +1,292 @@
+#include "RenderChain.h"
+#include "WorkPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Renders one WAV file through every point of a parameter grid on a work stealing thread pool.
+// The input is mapped once and read by every worker, each worker reuses one chain and its delay line arenas for all its renders.
+
+namespace
+{
+// one value per delay voice, for ratio and pan grids
+struct VoiceValues
+{
+    float values[DELAY_VOICES]{};
+};
+
+// values of every swept parameter, the grid is every combination
+struct BatchGrid
+{
+    std::vector<float> time_ms{500.0f};
+    std::vector<float> feedback{0.5f};
+    std::vector<float> flutter{0.0f};
+    std::vector<float> mix{0.5f};
+    std::vector<float> chorus{0.0f};
+    std::vector<float> ping_pong{0.0f};
+    std::vector<VoiceValues> ratios{};
+    std::vector<VoiceValues> pans{};
+
+    size_t size() const
+    {
+        return time_ms.size() * feedback.size() * flutter.size() * mix.size() * chorus.size() * ping_pong.size() * ratios.size() * pans.size();
+    }
+};
+
+// settings of one grid point
+struct BatchPoint
+{
+    RenderSetup setup{};
+    RenderControls controls{};
+};
+
+// measurements of one render
+struct BatchResult
+{
+    float peak{};           //> largest absolute sample of either channel
+    double rms{};           //> over both channels
+    double seconds{};       //> wall time of the render
+    bool ok{};
+};
+
+struct BatchOptions
+{
+    const char* input{};
+    const char* out_dir{};          //> when set every render is written to out_dir/render_<index>.wav
+    int workers{0};                 //> 0 uses every hardware thread
+    size_t block_frames{4096};
+    int bits{32};
+    float tail_seconds{0.0f};
+    RenderSetup setup{};            //> block mode and stereo input, ratios and pans come from the grid
+};
+
+void printUsage(const char* program)
+{
+    std::fprintf(stderr,
+        "usage: %s input.wav [--time ms,..] [--feedback x,..] [--flutter x,..] [--mix x,..] [--chorus 0,1] [--ping-pong 0,1]\n"
+        "       [--ratios r1:r2:r3,..] [--pans p1:p2:p3,..] [--workers n] [--out-dir dir] [--tail seconds] [--stereo]\n"
+        "       [--bits 16|24|32] [--block frames] [--block-mode low|balanced|efficient|throughput] [--seed n]\n"
+        "renders every combination of the listed values and prints a csv line of metrics per render, status is ok or failed\n", program);
+}
+
+// parses comma separated values, returns false if any isn't a number
+bool parseList(const char* text, std::vector<float>& values)
+{
+    values.clear();
+    while (*text != '\0')
+    {
+        char* end{};
+        values.push_back(std::strtof(text, &end));
+        if (end == text || (*end != ',' && *end != '\0')) {return false;}
+        text = *end == ',' ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+// parses comma separated groups of one colon separated value per voice, values must be in range 0.0f to 1.0f
+bool parseVoiceList(const char* text, std::vector<VoiceValues>& groups)
+{
+    groups.clear();
+    while (*text != '\0')
+    {
+        VoiceValues group{};
+        for (int voice_id{0}; voice_id < DELAY_VOICES; voice_id++)
+        {
+            char* end{};
+            group.values[voice_id] = std::strtof(text, &end);
+            const char separator {voice_id + 1 < DELAY_VOICES ? ':' : ','};
+            const bool valid {end != text && group.values[voice_id] >= 0.0f && group.values[voice_id] <= 1.0f};
+            if (!valid || (*end != separator && !(voice_id + 1 == DELAY_VOICES && *end == '\0'))) {return false;}
+            text = *end != '\0' ? end + 1 : end;
+        }
+        groups.push_back(group);
+    }
+    return !groups.empty();
+}
+
+bool parseOptions(int argc, char** argv, BatchOptions& options, BatchGrid& grid)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        const bool has_value {i + 1 < argc};
+        const char* arg {argv[i]};
+        bool ok {true};
+        if (has_value && std::strcmp(arg, "--time") == 0) {ok = parseList(argv[++i], grid.time_ms);}
+        else if (has_value && std::strcmp(arg, "--feedback") == 0) {ok = parseList(argv[++i], grid.feedback);}
+        else if (has_value && std::strcmp(arg, "--flutter") == 0) {ok = parseList(argv[++i], grid.flutter);}
+        else if (has_value && std::strcmp(arg, "--mix") == 0) {ok = parseList(argv[++i], grid.mix);}
+        else if (has_value && std::strcmp(arg, "--chorus") == 0) {ok = parseList(argv[++i], grid.chorus);}
+        else if (has_value && std::strcmp(arg, "--ping-pong") == 0) {ok = parseList(argv[++i], grid.ping_pong);}
+        else if (has_value && std::strcmp(arg, "--ratios") == 0) {ok = parseVoiceList(argv[++i], grid.ratios);}
+        else if (has_value && std::strcmp(arg, "--pans") == 0) {ok = parseVoiceList(argv[++i], grid.pans);}
+        else if (has_value && std::strcmp(arg, "--workers") == 0) {options.workers = std::atoi(argv[++i]);}
+        else if (has_value && std::strcmp(arg, "--out-dir") == 0) {options.out_dir = argv[++i];}
+        else if (has_value && std::strcmp(arg, "--tail") == 0) {options.tail_seconds = std::strtof(argv[++i], nullptr);}
+        else if (std::strcmp(arg, "--stereo") == 0) {options.setup.stereo = true;}
+        else if (has_value && std::strcmp(arg, "--bits") == 0) {options.bits = std::atoi(argv[++i]);}
+        else if (has_value && std::strcmp(arg, "--block") == 0) {options.block_frames = std::strtoul(argv[++i], nullptr, 10);}
+        else if (has_value && std::strcmp(arg, "--block-mode") == 0) {ok = parseBlockMode(argv[++i], options.setup.block_mode);}
+        else if (has_value && std::strcmp(arg, "--seed") == 0) {options.setup.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));}
+        else if (arg[0] != '-' && options.input == nullptr) {options.input = arg;}
+        else {ok = false;}
+        if (!ok) {return false;}
+    }
+    // unswept ratios and pans keep the pedal's
+    VoiceValues pedal{};
+    if (grid.ratios.empty())
+    {
+        std::copy(options.setup.ratios, options.setup.ratios + DELAY_VOICES, pedal.values);
+        grid.ratios.push_back(pedal);
+    }
+    if (grid.pans.empty())
+    {
+        std::copy(options.setup.pans, options.setup.pans + DELAY_VOICES, pedal.values);
+        grid.pans.push_back(pedal);
+    }
+    const bool valid_bits {options.bits == 16 || options.bits == 24 || options.bits == 32};
+    return options.input != nullptr && valid_bits && options.block_frames > 0 && options.tail_seconds >= 0.0f;
+}
+
+// returns settings of grid point index, the last listed parameter changes fastest
+BatchPoint gridPoint(const BatchGrid& grid, const BatchOptions& options, size_t index)
+{
+    // takes the next digit of index in base size
+    auto digit = [&index](size_t size) {const size_t d {index % size}; index /= size; return d;};
+    BatchPoint point{};
+    point.setup = options.setup;
+    const VoiceValues& pans {grid.pans[digit(grid.pans.size())]};
+    const VoiceValues& ratios {grid.ratios[digit(grid.ratios.size())]};
+    std::copy(pans.values, pans.values + DELAY_VOICES, point.setup.pans);
+    std::copy(ratios.values, ratios.values + DELAY_VOICES, point.setup.ratios);
+    point.controls.ping_pong = grid.ping_pong[digit(grid.ping_pong.size())] != 0.0f;
+    point.controls.chorus = grid.chorus[digit(grid.chorus.size())] != 0.0f;
+    point.controls.mix = std::min(1.0f, std::max(0.0f, grid.mix[digit(grid.mix.size())]));
+    point.controls.flutter = grid.flutter[digit(grid.flutter.size())];
+    point.controls.feedback = grid.feedback[digit(grid.feedback.size())];
+    point.controls.time_ms = grid.time_ms[digit(grid.time_ms.size())];
+    return point;
+}
+
+// renders one grid point with chain and measures its output, writes it when an output directory is set
+BatchResult renderPoint(RenderChain& chain, const WavReader& input, const BatchPoint& point, const BatchOptions& options, size_t index)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start {Clock::now()};
+    BatchResult result{};
+    if (!chain.init(point.setup, options.block_frames)) {return result;}
+    chain.setControls(point.controls);
+
+    WavWriter writer{};
+    if (options.out_dir != nullptr)
+    {
+        char path[1024]{};
+        std::snprintf(path, sizeof(path), "%s/render_%04zu.wav", options.out_dir, index);
+        if (!writer.open(path, SAMPLE_RATE, options.bits, options.block_frames)) {return result;}
+    }
+
+    const size_t total_frames {input.getFrames() + static_cast<size_t>(options.tail_seconds * SAMPLE_RATE)};
+    double sum_squares {0.0};
+    float peak {0.0f};
+    bool ok {true};
+    for (size_t frame{0}; frame < total_frames; frame += options.block_frames)
+    {
+        const size_t frames {std::min(options.block_frames, total_frames - frame)};
+        chain.process(input, frame, frames);
+        const float* left {chain.getLeft()};
+        const float* right {chain.getRight()};
+        // squares of a block are summed in float and carried in double, so hour long renders don't lose precision
+        float block_squares {0.0f};
+        for (size_t i{0}; i < frames; i++)
+        {
+            peak = std::max(peak, std::max(std::abs(left[i]), std::abs(right[i])));
+            block_squares += left[i] * left[i] + right[i] * right[i];
+        }
+        sum_squares += block_squares;
+        if (options.out_dir != nullptr) {ok = writer.write(left, right, frames) && ok;}
+    }
+    ok = writer.close() && ok;
+
+    result.peak = peak;
+    result.rms = total_frames > 0 ? std::sqrt(sum_squares / static_cast<double>(total_frames * 2)) : 0.0;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.ok = ok;
+    return result;
+}
+
+// writes one value per voice separated by colons
+void formatVoices(char* text, size_t size, const float* values)
+{
+    size_t used {0};
+    for (int voice_id{0}; voice_id < DELAY_VOICES && used < size; voice_id++)
+    {
+        used += static_cast<size_t>(std::snprintf(text + used, size - used, voice_id > 0 ? ":%g" : "%g", static_cast<double>(values[voice_id])));
+    }
+}
+
+// returns level in dBFS, silence is clamped to -200
+double decibels(double level) {return 20.0 * std::log10(std::max(level, 1.0e-10));}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BatchOptions options{};
+    BatchGrid grid{};
+    if (!parseOptions(argc, argv, options, grid))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    WavReader reader{};
+    if (!reader.open(options.input))
+    {
+        std::fprintf(stderr, "%s: %s\n", options.input, reader.getError());
+        return 1;
+    }
+    // engines are compiled for one rate and the renderer doesn't resample
+    if (reader.getFormat().sample_rate != SAMPLE_RATE)
+    {
+        std::fprintf(stderr, "%s: sample rate is %d Hz, the engines run at %d Hz\n", options.input, reader.getFormat().sample_rate, SAMPLE_RATE);
+        return 1;
+    }
+
+    // one chain per worker, its arenas hold the delay lines of every render the worker runs
+    WorkPool pool{options.workers};
+    std::vector<RenderChain> chains(static_cast<size_t>(pool.getWorkers()));
+    const size_t count {grid.size()};
+    std::vector<BatchResult> results(count);
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start {Clock::now()};
+    pool.run(count, [&](int worker, size_t index)
+    {
+        results[index] = renderPoint(chains[static_cast<size_t>(worker)], reader, gridPoint(grid, options, index), options, index);
+    });
+    const double seconds {std::chrono::duration<double>(Clock::now() - start).count()};
+
+    std::printf("index,time_ms,feedback,flutter,mix,chorus,ping_pong,ratios,pans,peak_db,rms_db,seconds,status\n");
+    bool ok {true};
+    for (size_t index{0}; index < count; index++)
+    {
+        const BatchPoint point {gridPoint(grid, options, index)};
+        const BatchResult& result {results[index]};
+        char ratios[128]{};
+        char pans[128]{};
+        formatVoices(ratios, sizeof(ratios), point.setup.ratios);
+        formatVoices(pans, sizeof(pans), point.setup.pans);
+        std::printf("%zu,%g,%g,%g,%g,%d,%d,%s,%s,%.2f,%.2f,%.3f,%s\n", index,
+            static_cast<double>(point.controls.time_ms), static_cast<double>(point.controls.feedback),
+            static_cast<double>(point.controls.flutter), static_cast<double>(point.controls.mix),
+            point.controls.chorus, point.controls.ping_pong, ratios, pans,
+            decibels(result.peak), decibels(result.rms), result.seconds, result.ok ? "ok" : "failed");
+        ok = ok && result.ok;
+    }
+
+    const double audio_seconds {static_cast<double>(count) * (static_cast<double>(reader.getFrames()) / SAMPLE_RATE + options.tail_seconds)};
+    std::fprintf(stderr, "%zu renders on %d workers in %.2f s, %.0fx real time\n", count, pool.getWorkers(), seconds, seconds > 0.0 ? audio_seconds / seconds : 0.0);
+    return ok ? 0 : 1;
+}
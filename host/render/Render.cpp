@@ -0,0 +1,213 @@
+#include "RenderChain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Renders a WAV file through the pedal's delay and chorus, see Effects.h.
+// Input is read from a memory map and processed in large blocks, so hour long files render in constant memory.
+
+namespace
+{
+// control change at a point in the input, read from a script
+struct RenderEvent
+{
+    size_t frame{};
+    char name[16]{};
+    float value{};
+    int voice{};        //> voice of bypass events
+};
+
+struct RenderOptions
+{
+    const char* input{};
+    const char* output{};
+    const char* script{};
+    size_t block_frames{4096};
+    int bits{32};
+    float tail_seconds{0.0f};       //> silence rendered after the input so delay tails ring out
+    RenderSetup setup{};
+};
+
+void printUsage(const char* program)
+{
+    std::fprintf(stderr,
+        "usage: %s input.wav output.wav [--time ms] [--feedback x] [--flutter x] [--mix x] [--chorus] [--ping-pong]\n"
+        "       [--bypass voice] [--script file] [--tail seconds] [--stereo] [--bits 16|24|32]\n"
+        "       [--block frames] [--block-mode low|balanced|efficient|throughput] [--seed n]\n"
+        "script lines are '<seconds> <control> <value>', controls are time, feedback, flutter, mix, chorus, ping-pong,\n"
+        "and 'bypass <voice> <0|1>', lines starting with # are ignored\n"
+        "delay controls take effect at the first sub-block start of the block mode at or after their time\n", program);
+}
+
+// applies a named control, returns false if the name is unknown
+bool setControl(RenderControls& controls, const char* name, float value, int voice)
+{
+    if (std::strcmp(name, "time") == 0) {controls.time_ms = value;}
+    else if (std::strcmp(name, "feedback") == 0) {controls.feedback = value;}
+    else if (std::strcmp(name, "flutter") == 0) {controls.flutter = value;}
+    else if (std::strcmp(name, "mix") == 0) {controls.mix = std::min(1.0f, std::max(0.0f, value));}
+    else if (std::strcmp(name, "chorus") == 0) {controls.chorus = value != 0.0f;}
+    else if (std::strcmp(name, "ping-pong") == 0) {controls.ping_pong = value != 0.0f;}
+    else if (std::strcmp(name, "bypass") == 0 && voice >= 0 && voice < DELAY_VOICES) {controls.bypass[voice] = value != 0.0f;}
+    else {return false;}
+    return true;
+}
+
+// reads timed control changes, returns false and prints the line if the script can't be parsed
+bool readScript(const char* path, std::vector<RenderEvent>& events)
+{
+    std::FILE* file {std::fopen(path, "r")};
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "can't open script %s\n", path);
+        return false;
+    }
+    char line[256]{};
+    int line_number {0};
+    RenderControls check{};
+    bool ok {true};
+    while (ok && std::fgets(line, sizeof(line), file) != nullptr)
+    {
+        line_number++;
+        line[std::strcspn(line, "\r\n")] = '\0';
+        const char* text {line + std::strspn(line, " \t")};
+        if (*text == '#' || *text == '\0') {continue;}
+        double seconds {0.0};
+        RenderEvent event{};
+        int consumed {0};
+        ok = std::sscanf(text, "%lf %15s %n", &seconds, event.name, &consumed) == 2;
+        const char* values {text + consumed};
+        if (ok && std::strcmp(event.name, "bypass") == 0)
+        {
+            ok = std::sscanf(values, "%d %f", &event.voice, &event.value) == 2;
+            event.voice--;
+        }
+        else if (ok) {ok = std::sscanf(values, "%f", &event.value) == 1;}
+        ok = ok && seconds >= 0.0 && setControl(check, event.name, event.value, event.voice);
+        event.frame = static_cast<size_t>(seconds * SAMPLE_RATE);
+        if (ok) {events.push_back(event);}
+        else {std::fprintf(stderr, "%s:%d: can't parse '%s'\n", path, line_number, text);}
+    }
+    std::fclose(file);
+    // events at the same time keep their order in the file
+    std::stable_sort(events.begin(), events.end(), [](const RenderEvent& a, const RenderEvent& b) {return a.frame < b.frame;});
+    return ok;
+}
+
+bool parseOptions(int argc, char** argv, RenderOptions& options, RenderControls& controls)
+{
+    int positional {0};
+    for (int i{1}; i < argc; i++)
+    {
+        const bool has_value {i + 1 < argc};
+        const char* arg {argv[i]};
+        if (has_value && std::strcmp(arg, "--time") == 0) {controls.time_ms = std::strtof(argv[++i], nullptr);}
+        else if (has_value && std::strcmp(arg, "--feedback") == 0) {controls.feedback = std::strtof(argv[++i], nullptr);}
+        else if (has_value && std::strcmp(arg, "--flutter") == 0) {controls.flutter = std::strtof(argv[++i], nullptr);}
+        else if (has_value && std::strcmp(arg, "--mix") == 0) {setControl(controls, "mix", std::strtof(argv[++i], nullptr), 0);}
+        else if (std::strcmp(arg, "--chorus") == 0) {controls.chorus = true;}
+        else if (std::strcmp(arg, "--ping-pong") == 0) {controls.ping_pong = true;}
+        else if (has_value && std::strcmp(arg, "--bypass") == 0)
+        {
+            if (!setControl(controls, "bypass", 1.0f, std::atoi(argv[++i]) - 1)) {return false;}
+        }
+        else if (has_value && std::strcmp(arg, "--script") == 0) {options.script = argv[++i];}
+        else if (has_value && std::strcmp(arg, "--tail") == 0) {options.tail_seconds = std::strtof(argv[++i], nullptr);}
+        else if (std::strcmp(arg, "--stereo") == 0) {options.setup.stereo = true;}
+        else if (has_value && std::strcmp(arg, "--bits") == 0) {options.bits = std::atoi(argv[++i]);}
+        else if (has_value && std::strcmp(arg, "--block") == 0) {options.block_frames = std::strtoul(argv[++i], nullptr, 10);}
+        else if (has_value && std::strcmp(arg, "--block-mode") == 0)
+        {
+            if (!parseBlockMode(argv[++i], options.setup.block_mode)) {return false;}
+        }
+        else if (has_value && std::strcmp(arg, "--seed") == 0) {options.setup.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));}
+        else if (arg[0] != '-' && positional < 2) {(positional++ == 0 ? options.input : options.output) = arg;}
+        else {return false;}
+    }
+    const bool valid_bits {options.bits == 16 || options.bits == 24 || options.bits == 32};
+    return positional == 2 && valid_bits && options.block_frames > 0 && options.tail_seconds >= 0.0f;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    RenderOptions options{};
+    RenderControls controls{};
+    if (!parseOptions(argc, argv, options, controls))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::vector<RenderEvent> events{};
+    if (options.script != nullptr && !readScript(options.script, events)) {return 1;}
+
+    WavReader reader{};
+    if (!reader.open(options.input))
+    {
+        std::fprintf(stderr, "%s: %s\n", options.input, reader.getError());
+        return 1;
+    }
+    // engines are compiled for one rate and the renderer doesn't resample
+    if (reader.getFormat().sample_rate != SAMPLE_RATE)
+    {
+        std::fprintf(stderr, "%s: sample rate is %d Hz, the engines run at %d Hz\n", options.input, reader.getFormat().sample_rate, SAMPLE_RATE);
+        return 1;
+    }
+
+    // engines hold their parameters inline, keep the chain off the stack
+    std::unique_ptr<RenderChain> chain {new RenderChain{}};
+    if (!chain->init(options.setup, options.block_frames)) {return 1;}
+    chain->setControls(controls);
+
+    WavWriter writer{};
+    if (!writer.open(options.output, SAMPLE_RATE, options.bits, options.block_frames))
+    {
+        std::fprintf(stderr, "%s: can't create output\n", options.output);
+        return 1;
+    }
+
+    const size_t input_frames {reader.getFrames()};
+    const size_t total_frames {input_frames + static_cast<size_t>(options.tail_seconds * SAMPLE_RATE)};
+    size_t next_event {0};
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start {Clock::now()};
+    for (size_t frame{0}; frame < total_frames;)
+    {
+        // blocks end at the next script event, mix and chorus switch at its frame
+        // engine controls are applied at the engines' first sub-block start from that frame on, like on the pedal
+        bool changed {false};
+        for (; next_event < events.size() && events[next_event].frame <= frame; next_event++)
+        {
+            const RenderEvent& event {events[next_event]};
+            changed = setControl(controls, event.name, event.value, event.voice) || changed;
+        }
+        if (changed) {chain->setControls(controls);}
+        size_t frames {std::min(options.block_frames, total_frames - frame)};
+        if (next_event < events.size()) {frames = std::min(frames, events[next_event].frame - frame);}
+
+        chain->process(reader, frame, frames);
+        if (!writer.write(chain->getLeft(), chain->getRight(), frames))
+        {
+            std::fprintf(stderr, "%s: write failed\n", options.output);
+            return 1;
+        }
+        frame += frames;
+        reader.release(std::min(frame, input_frames));
+    }
+    if (!writer.close())
+    {
+        std::fprintf(stderr, "%s: write failed\n", options.output);
+        return 1;
+    }
+
+    const double seconds {std::chrono::duration<double>(Clock::now() - start).count()};
+    const double audio_seconds {static_cast<double>(total_frames) / SAMPLE_RATE};
+    std::fprintf(stderr, "rendered %.1f s of audio in %.2f s, %.0fx real time\n", audio_seconds, seconds, seconds > 0.0 ? audio_seconds / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "RenderChain.h"
+
+#include <algorithm>
+#include <cstring>
+
+RenderSetup::RenderSetup()
+{
+    std::copy(DELAY_RATIOS, DELAY_RATIOS + DELAY_VOICES, ratios);
+    std::copy(DELAY_PANS, DELAY_PANS + DELAY_VOICES, pans);
+}
+
+RenderChain::RenderChain()
+:_fast_storage(ChorusEffect::memorySize(CHORUS_RATIOS) + DelayMemory::ALIGNMENT),
+_bulk_storage(DelayEffect::memorySize() + DelayMemory::ALIGNMENT)
+{
+    // vectors aren't cache line aligned, so the arenas have room to align the first buffer
+    _memory.init(_fast_storage.data(), _fast_storage.size(), _bulk_storage.data(), _bulk_storage.size());
+}
+
+bool RenderChain::init(const RenderSetup& setup, size_t block_frames)
+{
+    _setup = setup;
+    _memory.reset();
+    if (!_delay.init(_memory, _setup.ratios) || !_chorus.init(_memory, CHORUS_RATIOS)) {return false;}
+    _delay.setBlockMode(_setup.block_mode);
+    _chorus.setBlockMode(_setup.block_mode);
+    setupDelay(_delay, _setup.pans, _setup.seed);
+    setupChorus(_chorus, _setup.seed);
+    _left.assign(block_frames, 0.0f);
+    _right.assign(block_frames, 0.0f);
+    _wet_left.assign(block_frames, 0.0f);
+    _wet_right.assign(block_frames, 0.0f);
+    return true;
+}
+
+void RenderChain::setControls(const RenderControls& controls)
+{
+    _delay.setMasterDelayTime(controls.time_ms * 0.001f * SAMPLE_RATE);
+    _delay.setMasterFeedback(controls.feedback);
+    _delay.setMasterFlutter(controls.flutter);
+    _delay.setPingPongMode(controls.ping_pong);
+    for (int voice_id{0}; voice_id < DELAY_VOICES; voice_id++) {_delay.setBypass(voice_id, controls.bypass[voice_id]);}
+    _mix = controls.mix;
+    _chorus_on = controls.chorus;
+}
+
+void RenderChain::process(const WavReader& input, size_t frame, size_t frames)
+{
+    // read input, past its end the chain is fed silence so tails ring out
+    const size_t input_frames {input.getFrames()};
+    const size_t input_block {frame < input_frames ? std::min(frames, input_frames - frame) : 0};
+    input.read(frame, input_block, _left.data(), _right.data());
+    std::fill(_left.begin() + input_block, _left.begin() + frames, 0.0f);
+    std::fill(_right.begin() + input_block, _right.begin() + frames, 0.0f);
+    for (size_t i{0}; i < frames; i++)
+    {
+        _left[i] *= INPUT_GAIN;
+        _right[i] = _setup.stereo ? _right[i] * INPUT_GAIN : _left[i];
+    }
+
+    // same stages as the audio callback
+    _delay.process(_left.data(), _right.data(), _wet_left.data(), _wet_right.data(), frames);
+    mixStage(_left.data(), _right.data(), _wet_left.data(), _wet_right.data(), _mix, frames);
+    if (_chorus_on)
+    {
+        _chorus.process(_left.data(), _right.data(), _wet_left.data(), _wet_right.data(), frames);
+        mixStage(_left.data(), _right.data(), _wet_left.data(), _wet_right.data(), CHORUS_MIX, frames);
+    }
+}
+
+bool parseBlockMode(const char* name, BlockMode& mode)
+{
+    const struct {const char* name; BlockMode mode;} modes[] {
+        {"low", BlockMode::LOW_LATENCY},
+        {"balanced", BlockMode::BALANCED},
+        {"efficient", BlockMode::EFFICIENT},
+        {"throughput", BlockMode::THROUGHPUT},
+    };
+    for (const auto& m : modes)
+    {
+        if (std::strcmp(name, m.name) == 0)
+        {
+            mode = m.mode;
+            return true;
+        }
+    }
+    return false;
+}
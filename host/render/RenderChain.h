@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Effects.h"
+#include "WavFile.h"
+
+#include <cstddef>
+#include <vector>
+
+// The pedal's delay and chorus with their own delay line memory, rendering blocks of a WAV file.
+// Each chain owns its arenas, so chains on different threads share nothing but the read only input.
+
+// pedal controls, the values the pots and switches would set
+struct RenderControls
+{
+    float time_ms{500.0f};          //> master delay time in milliseconds
+    float feedback{0.5f};
+    float flutter{0.0f};
+    float mix{0.5f};                //> delay wet/dry mix
+    bool chorus{false};
+    bool ping_pong{false};
+    bool bypass[DELAY_VOICES]{};
+};
+
+// settings fixed for a whole render
+struct RenderSetup
+{
+    float ratios[DELAY_VOICES]{};   //> delay ratio of each voice, DELAY_RATIOS by default
+    float pans[DELAY_VOICES]{};     //> pan of each voice, DELAY_PANS by default
+    BlockMode block_mode{BlockMode::LOW_LATENCY};
+    bool stereo{false};             //> feed the right input channel to the right side, the pedal takes mono from the left
+    uint32_t seed{NOISE_SEED};      //> flutter noise seed, renders with equal seeds are identical
+
+    RenderSetup();
+};
+
+// reads a block mode named low, balanced, efficient or throughput, returns false if name is none of them
+bool parseBlockMode(const char* name, BlockMode& mode);
+
+class RenderChain
+{
+public:
+    // takes memory for full length delay lines, so any ratios fit without allocating again
+    RenderChain();
+    // engines point into the chain's arenas and their own member arrays, a copy would write into the source chain
+    RenderChain(const RenderChain&) = delete;
+    RenderChain& operator=(const RenderChain&) = delete;
+
+    // clears delay lines and sets up engines for one render of blocks up to block_frames, returns false if memory has no room
+    bool init(const RenderSetup& setup, size_t block_frames);
+    // hands controls to the engines, they apply them at their next sub-block like the pedal
+    void setControls(const RenderControls& controls);
+    // renders frames of input starting at frame into getLeft and getRight, frames past the end of the input are silence
+    void process(const WavReader& input, size_t frame, size_t frames);
+
+    // output of the last process call
+    const float* getLeft() const {return _left.data();}
+    const float* getRight() const {return _right.data();}
+
+private:
+    // host memory has a single tier, separate arenas stand in for on-chip and SDRAM memory
+    std::vector<uint8_t> _fast_storage{};
+    std::vector<uint8_t> _bulk_storage{};
+    DelayMemory _memory{};
+    DelayEffect _delay{};
+    ChorusEffect _chorus{};
+    RenderSetup _setup{};
+    float _mix{};
+    bool _chorus_on{};
+    // block buffers, dry holds the output
+    std::vector<float> _left{};
+    std::vector<float> _right{};
+    std::vector<float> _wet_left{};
+    std::vector<float> _wet_right{};
+};
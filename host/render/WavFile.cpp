@@ -0,0 +1,231 @@
+#include "WavFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr uint16_t FORMAT_PCM{1};
+constexpr uint16_t FORMAT_FLOAT{3};
+constexpr uint16_t FORMAT_EXTENSIBLE{0xFFFE};
+constexpr size_t RELEASE_STEP{8 * 1024 * 1024};    //> bytes of finished input dropped per madvise call
+
+uint16_t readU16(const uint8_t* p) {return static_cast<uint16_t>(p[0] | (p[1] << 8));}
+uint32_t readU32(const uint8_t* p) {return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);}
+void writeU16(uint8_t* p, uint16_t x) {p[0] = static_cast<uint8_t>(x); p[1] = static_cast<uint8_t>(x >> 8);}
+void writeU32(uint8_t* p, uint32_t x) {writeU16(p, static_cast<uint16_t>(x)); writeU16(p + 2, static_cast<uint16_t>(x >> 16));}
+
+// returns x scaled to a signed integer of bits, clipped to full scale
+int32_t quantize(float x, int bits)
+{
+    const float full_scale {static_cast<float>(int32_t{1} << (bits - 1))};
+    const float scaled {std::min(full_scale - 1.0f, std::max(-full_scale, x * full_scale))};
+    return static_cast<int32_t>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+}
+} // namespace
+
+bool WavReader::open(const char* path)
+{
+    close();
+    const int fd {::open(path, O_RDONLY)};
+    if (fd < 0) {return fail("can't open input");}
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size < 12)
+    {
+        ::close(fd);
+        return fail("input is too short to be a WAV file");
+    }
+    _map_size = static_cast<size_t>(info.st_size);
+    void* map {mmap(nullptr, _map_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        _map_size = 0;
+        return fail("can't map input");
+    }
+    _map = static_cast<const uint8_t*>(map);
+    madvise(map, _map_size, MADV_SEQUENTIAL);
+    return parse();
+}
+
+void WavReader::close()
+{
+    if (_map != nullptr) {munmap(const_cast<uint8_t*>(_map), _map_size);}
+    _map = nullptr;
+    _map_size = 0;
+    _data = nullptr;
+    _frames = 0;
+    _released = 0;
+}
+
+bool WavReader::parse()
+{
+    if (std::memcmp(_map, "RIFF", 4) != 0 || std::memcmp(_map + 8, "WAVE", 4) != 0) {return fail("input is not a RIFF WAVE file");}
+    uint16_t tag {0};
+    size_t frame_bytes {0};
+    bool have_format {false};
+    // walk chunks until the data chunk, fmt must come before it
+    size_t offset {12};
+    while (offset + 8 <= _map_size)
+    {
+        const uint8_t* chunk {_map + offset};
+        const size_t size {readU32(chunk + 4)};
+        const size_t body {offset + 8};
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && body + size <= _map_size)
+        {
+            tag = readU16(chunk + 8);
+            _format.channels = readU16(chunk + 10);
+            _format.sample_rate = static_cast<int>(readU32(chunk + 12));
+            frame_bytes = readU16(chunk + 20);
+            _format.bits = readU16(chunk + 22);
+            // extensible headers keep the real format tag at the start of the sub format guid
+            if (tag == FORMAT_EXTENSIBLE && size >= 40) {tag = readU16(chunk + 32);}
+            have_format = true;
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            if (!have_format) {return fail("input has no fmt chunk before its data");}
+            _data = _map + body;
+            // streamed files may leave the size unset, so never read past the end of the file
+            const size_t data_bytes {std::min(size, _map_size - body)};
+            _frames = frame_bytes > 0 ? data_bytes / frame_bytes : 0;
+            break;
+        }
+        offset = body + size + (size & 1);
+    }
+    if (_data == nullptr) {return fail("input has no data chunk");}
+
+    _format.is_float = tag == FORMAT_FLOAT;
+    const bool pcm_bits {_format.bits == 8 || _format.bits == 16 || _format.bits == 24 || _format.bits == 32};
+    const bool float_bits {_format.bits == 32 || _format.bits == 64};
+    if ((tag != FORMAT_PCM && tag != FORMAT_FLOAT) || (tag == FORMAT_PCM && !pcm_bits) || (tag == FORMAT_FLOAT && !float_bits))
+    {
+        return fail("input sample format isn't supported, use PCM or float");
+    }
+    if (_format.channels < 1 || frame_bytes != static_cast<size_t>(_format.frameBytes())) {return fail("input channel layout isn't supported");}
+    return true;
+}
+
+float WavReader::sample(const uint8_t* frame, int channel) const
+{
+    const uint8_t* p {frame + channel * (_format.bits / 8)};
+    if (_format.is_float)
+    {
+        if (_format.bits == 64)
+        {
+            double x{};
+            std::memcpy(&x, p, sizeof(x));
+            return static_cast<float>(x);
+        }
+        float x{};
+        std::memcpy(&x, p, sizeof(x));
+        return x;
+    }
+    switch (_format.bits)
+    {
+    case 8: return static_cast<float>(static_cast<int>(p[0]) - 128) * (1.0f / 128.0f);
+    case 16: return static_cast<float>(static_cast<int16_t>(readU16(p))) * (1.0f / 32768.0f);
+    case 24: return static_cast<float>(static_cast<int32_t>(static_cast<uint32_t>(p[0] | (p[1] << 8) | (p[2] << 16)) << 8) >> 8) * (1.0f / 8388608.0f);
+    default: return static_cast<float>(static_cast<int32_t>(readU32(p))) * (1.0f / 2147483648.0f);
+    }
+}
+
+void WavReader::read(size_t frame, size_t frames, float* left, float* right) const
+{
+    const size_t frame_bytes {static_cast<size_t>(_format.frameBytes())};
+    const uint8_t* p {_data + frame * frame_bytes};
+    const int right_channel {_format.channels > 1 ? 1 : 0};
+    for (size_t i{0}; i < frames; i++, p += frame_bytes)
+    {
+        left[i] = sample(p, 0);
+        right[i] = sample(p, right_channel);
+    }
+}
+
+void WavReader::release(size_t frame)
+{
+    // only whole pages can be dropped, and only in large steps so madvise stays off the render path
+    const size_t page {static_cast<size_t>(sysconf(_SC_PAGESIZE))};
+    const size_t end {(static_cast<size_t>(_data - _map) + frame * static_cast<size_t>(_format.frameBytes())) / page * page};
+    if (end < _released + RELEASE_STEP) {return;}
+    madvise(const_cast<uint8_t*>(_map) + _released, end - _released, MADV_DONTNEED);
+    _released = end;
+}
+
+bool WavWriter::open(const char* path, int sample_rate, int bits, size_t block_frames)
+{
+    close();
+    _format.channels = 2;
+    _format.sample_rate = sample_rate;
+    _format.bits = bits;
+    _format.is_float = bits == 32;
+    _buffer.assign(block_frames * static_cast<size_t>(_format.frameBytes()), 0);
+    _frames = 0;
+    _ok = true;
+    _file = std::fopen(path, "wb");
+    if (_file == nullptr) {return false;}
+    // sizes are unknown until close, write a placeholder header to reserve the space
+    return writeHeader(0);
+}
+
+bool WavWriter::write(const float* left, const float* right, size_t frames)
+{
+    if (_file == nullptr) {return false;}
+    const int bytes {_format.bits / 8};
+    uint8_t* p {_buffer.data()};
+    for (size_t i{0}; i < frames; i++)
+    {
+        const float channels[2] {left[i], right[i]};
+        for (float x : channels)
+        {
+            if (_format.is_float) {std::memcpy(p, &x, sizeof(x));}
+            else
+            {
+                const uint32_t q {static_cast<uint32_t>(quantize(x, _format.bits))};
+                for (int b{0}; b < bytes; b++) {p[b] = static_cast<uint8_t>(q >> (8 * b));}
+            }
+            p += bytes;
+        }
+    }
+    const size_t size {frames * static_cast<size_t>(_format.frameBytes())};
+    _ok = _ok && std::fwrite(_buffer.data(), 1, size, _file) == size;
+    _frames += frames;
+    return _ok;
+}
+
+bool WavWriter::close()
+{
+    if (_file == nullptr) {return _ok;}
+    const uint64_t data_bytes {static_cast<uint64_t>(_frames) * static_cast<uint64_t>(_format.frameBytes())};
+    _ok = _ok && std::fseek(_file, 0, SEEK_SET) == 0 && writeHeader(data_bytes);
+    _ok = std::fclose(_file) == 0 && _ok;
+    _file = nullptr;
+    return _ok;
+}
+
+bool WavWriter::writeHeader(uint64_t data_bytes)
+{
+    // RIFF sizes are 32 bit, longer files keep their data but readers must take the size from the file length
+    const uint32_t data_size {static_cast<uint32_t>(std::min<uint64_t>(data_bytes, 0xFFFFFFFFu - 36))};
+    uint8_t header[44]{};
+    std::memcpy(header, "RIFF", 4);
+    writeU32(header + 4, 36 + data_size);
+    std::memcpy(header + 8, "WAVE", 4);
+    std::memcpy(header + 12, "fmt ", 4);
+    writeU32(header + 16, 16);
+    writeU16(header + 20, _format.is_float ? FORMAT_FLOAT : FORMAT_PCM);
+    writeU16(header + 22, static_cast<uint16_t>(_format.channels));
+    writeU32(header + 24, static_cast<uint32_t>(_format.sample_rate));
+    writeU32(header + 28, static_cast<uint32_t>(_format.sample_rate * _format.frameBytes()));
+    writeU16(header + 32, static_cast<uint16_t>(_format.frameBytes()));
+    writeU16(header + 34, static_cast<uint16_t>(_format.bits));
+    std::memcpy(header + 36, "data", 4);
+    writeU32(header + 40, data_size);
+    _ok = _ok && std::fwrite(header, 1, sizeof(header), _file) == sizeof(header);
+    return _ok;
+}
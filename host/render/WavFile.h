@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Streaming WAV input and output for the offline renderer.
+// Input is memory mapped and converted a block at a time, output is written in blocks, so memory doesn't grow with file length.
+
+// sample encoding of a WAV file
+struct WavFormat
+{
+    int channels{};
+    int sample_rate{};
+    int bits{};             //> bits per sample
+    bool is_float{};        //> IEEE float samples, otherwise signed PCM (unsigned for 8 bit)
+
+    int frameBytes() const {return channels * (bits / 8);}
+};
+
+// Memory mapped WAV reader, PCM 8/16/24/32 bit and 32/64 bit float with any channel count.
+class WavReader
+{
+public:
+    WavReader() {}
+    ~WavReader() {close();}
+    WavReader(const WavReader&) = delete;
+    WavReader& operator=(const WavReader&) = delete;
+
+    // maps path and parses its header, returns false and sets getError if it can't be read
+    bool open(const char* path);
+    void close();
+    // converts frames starting at frame to float, mono files are copied to both channels and extra channels are dropped
+    void read(size_t frame, size_t frames, float* left, float* right) const;
+    // lets the kernel drop mapped pages before frame, call as blocks are finished to keep memory use flat
+    void release(size_t frame);
+
+    const WavFormat& getFormat() const {return _format;}
+    size_t getFrames() const {return _frames;}
+    const char* getError() const {return _error;}
+
+private:
+    const uint8_t* _map{};      //> whole file
+    size_t _map_size{};
+    const uint8_t* _data{};     //> first frame in _map
+    size_t _frames{};
+    size_t _released{};         //> bytes of data already given back to the kernel
+    WavFormat _format{};
+    const char* _error{""};
+
+    bool fail(const char* error) {_error = error; close(); return false;}
+    bool parse();
+    // returns channel of frame as float in range -1.0f to 1.0f
+    float sample(const uint8_t* frame, int channel) const;
+};
+
+// Stereo WAV writer, 16 or 24 bit PCM or 32 bit float, the header sizes are patched in by close.
+class WavWriter
+{
+public:
+    WavWriter() {}
+    ~WavWriter() {close();}
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    // creates path, bits is 16, 24 or 32 for float, block_frames is the largest block passed to write
+    bool open(const char* path, int sample_rate, int bits, size_t block_frames);
+    // appends frames, PCM output is clipped to full scale
+    bool write(const float* left, const float* right, size_t frames);
+    // finishes the header and closes the file, returns false if anything failed to write
+    bool close();
+
+    size_t getFrames() const {return _frames;}
+
+private:
+    std::FILE* _file{};
+    WavFormat _format{};
+    std::vector<uint8_t> _buffer{};     //> one interleaved block
+    size_t _frames{};
+    bool _ok{true};
+
+    bool writeHeader(uint64_t data_bytes);
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a fixed set of independent jobs on a pool of threads with work stealing.
+// Jobs are dealt out round robin, each worker takes its own jobs from the back of its queue
+// and when it runs out steals from the front of the others, so uneven jobs still keep every core busy.
+class WorkPool
+{
+public:
+    // workers below 1 use one per hardware thread
+    explicit WorkPool(int workers)
+    :_workers{workers > 0 ? workers : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))} {}
+
+    // calls job(worker, index) for every index below count and returns once all are done, worker is below getWorkers
+    template <typename Job>
+    void run(size_t count, Job job)
+    {
+        std::vector<Queue> queues(static_cast<size_t>(_workers));
+        for (size_t index{0}; index < count; index++) {queues[index % queues.size()].jobs.push_back(index);}
+
+        std::vector<std::thread> threads{};
+        for (int worker{0}; worker < _workers; worker++)
+        {
+            threads.emplace_back([&queues, &job, worker]()
+            {
+                size_t index{};
+                // no jobs are added once running, so a worker is done when every queue is empty
+                while (take(queues, worker, index)) {job(worker, index);}
+            });
+        }
+        for (std::thread& thread : threads) {thread.join();}
+    }
+
+    int getWorkers() const {return _workers;}
+
+private:
+    struct Queue
+    {
+        std::mutex lock{};
+        std::deque<size_t> jobs{};
+    };
+
+    int _workers{};
+
+    // takes the next job of worker, or steals one, returns false when no jobs are left
+    static bool take(std::vector<Queue>& queues, int worker, size_t& index)
+    {
+        const size_t count {queues.size()};
+        for (size_t n{0}; n < count; n++)
+        {
+            const bool own {n == 0};
+            Queue& queue {queues[(static_cast<size_t>(worker) + n) % count]};
+            std::lock_guard<std::mutex> guard{queue.lock};
+            if (queue.jobs.empty()) {continue;}
+            // owners work from the back and thieves from the front so they rarely want the same job
+            index = own ? queue.jobs.back() : queue.jobs.front();
+            if (own) {queue.jobs.pop_back();}
+            else {queue.jobs.pop_front();}
+            return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,215 @@
+#include "Encoder.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+// Drives an Encoder through simulated GPIO pins at high edge rates with contact bounce and checks no step or press is lost.
+// One thread plays both the knob and the timer interrupt, so the pins change between ticks like on the pedal,
+// while the main thread polls events like a control loop that is often busy.
+
+namespace
+{
+// how the simulated knob is turned
+struct StressCase
+{
+    float edge_rate{};      //> quadrature transitions per tick, 1.0f is the fastest the decoder can follow
+    bool bounce{};          //> contacts chatter between the old and new state after each edge
+};
+
+struct StressOptions
+{
+    int ticks{4000000};     //> timer ticks per case, 1000 s of turning at 4kHz
+    int poll_ticks{400};    //> timer ticks between control loop polls, 100 ms of a busy loop at 4kHz
+    unsigned seed{1};
+};
+
+struct StressResult
+{
+    int expected_steps{};
+    int steps{};
+    int expected_presses{};
+    int presses{};
+    int releases{};
+    bool alternating{true}; //> press and release events took turns
+    double seconds{};
+};
+
+// pin levels of each position within a step, clockwise order
+void writePhase(daisy::GPIO& a, daisy::GPIO& b, int position)
+{
+    static constexpr bool A[4] {false, true, true, false};
+    static constexpr bool B[4] {false, false, true, true};
+    const int phase {position & 3};
+    a.Write(A[phase]);
+    b.Write(B[phase]);
+}
+
+StressResult runCase(const StressCase& stress, const StressOptions& options)
+{
+    daisy::GPIO a{};
+    daisy::GPIO b{};
+    daisy::GPIO button{};
+    a.Init(daisy::Pin{}, daisy::GPIO::Mode::INPUT, daisy::GPIO::Pull::PULLUP);
+    b.Init(daisy::Pin{}, daisy::GPIO::Mode::INPUT, daisy::GPIO::Pull::PULLUP);
+    button.Init(daisy::Pin{}, daisy::GPIO::Mode::INPUT, daisy::GPIO::Pull::PULLUP);
+    writePhase(a, b, 0);
+    Encoder encoder{};
+    encoder.init(&a, &b, &button);
+
+    StressResult result{};
+    std::atomic<bool> done{false};
+    std::atomic<int> ticked{0};     //> ticks run by the hardware thread
+    std::atomic<int> polled{0};     //> tick count at the control loop's last poll
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start {Clock::now()};
+
+    // knob and timer interrupt
+    std::thread hardware([&]()
+    {
+        std::mt19937 rng{options.seed};
+        std::uniform_real_distribution<float> chance{0.0f, 1.0f};
+        int position {0};
+        int direction {1};
+        float edges {0.0f};
+        int bounce_ticks {0};
+        int bounce_from {0};        //> position before the edge that is bouncing
+        int held_ticks {0};
+        bool pressed {false};
+        for (int tick{0}; tick < options.ticks; tick++)
+        {
+            // the interrupt doesn't wait for the control loop, but keep the threads in step so polls come every poll_ticks
+            while (tick - polled.load(std::memory_order_acquire) > options.poll_ticks) {std::this_thread::yield();}
+            // turn, ending on a detent so every transition must have been counted
+            const bool settling {tick >= options.ticks - 1000};
+            if (settling) {direction = (position & 3) == 0 ? 0 : 1;}
+            else if (chance(rng) < 0.0005f) {direction = -direction;}
+            if (bounce_ticks > 0)
+            {
+                // chatter between the last two states, the decoder sees a step back and forth
+                bounce_ticks--;
+                writePhase(a, b, chance(rng) < 0.5f ? position : bounce_from);
+                if (bounce_ticks == 0) {writePhase(a, b, position);}
+            }
+            else
+            {
+                edges += settling ? 1.0f : stress.edge_rate;
+                if (edges >= 1.0f && direction != 0)
+                {
+                    edges -= 1.0f;
+                    bounce_from = position;
+                    position += direction;
+                    writePhase(a, b, position);
+                    if (stress.bounce && !settling) {bounce_ticks = static_cast<int>(chance(rng) * 4.0f);}
+                }
+            }
+
+            // press and release with bounce, held long enough to pass the debounce, and let go before the end
+            if (held_ticks == 0 && (settling ? pressed : chance(rng) < 0.001f))
+            {
+                pressed = !pressed;
+                held_ticks = Encoder::DEBOUNCE_TICKS * 4;
+                if (pressed) {result.expected_presses++;}
+            }
+            if (held_ticks > 0)
+            {
+                held_ticks--;
+                const bool chatter {stress.bounce && held_ticks > Encoder::DEBOUNCE_TICKS * 3 && chance(rng) < 0.5f};
+                button.Write(pressed == chatter);
+            }
+            else {button.Write(!pressed);}
+
+            encoder.tick();
+            ticked.store(tick + 1, std::memory_order_release);
+        }
+        result.expected_steps = position / Encoder::TRANSITIONS_PER_STEP;
+        done.store(true, std::memory_order_release);
+    });
+
+    // control loop, only polls every poll_ticks so the queue fills
+    bool last_press {false};
+    auto drain = [&]()
+    {
+        EncoderEvent event{};
+        while (encoder.poll(event))
+        {
+            if (event.type == EncoderEventType::TURN) {result.steps += event.steps;}
+            else
+            {
+                const bool press {event.type == EncoderEventType::PRESS};
+                result.alternating = result.alternating && press != last_press;
+                last_press = press;
+                (press ? result.presses : result.releases)++;
+            }
+        }
+    };
+    while (!done.load(std::memory_order_acquire))
+    {
+        const int tick {ticked.load(std::memory_order_acquire)};
+        if (tick - polled.load(std::memory_order_relaxed) < options.poll_ticks)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        drain();
+        polled.store(tick, std::memory_order_release);
+    }
+    hardware.join();
+    // the last steps may still be held back by a full queue, tick until the encoder has handed them over
+    for (int tick{0}; tick < 1000; tick++)
+    {
+        encoder.tick();
+        drain();
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+bool parseOptions(int argc, char** argv, StressOptions& options)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        const bool has_value {i + 1 < argc};
+        if (has_value && std::strcmp(argv[i], "--ticks") == 0) {options.ticks = std::atoi(argv[++i]);}
+        else if (has_value && std::strcmp(argv[i], "--poll-ticks") == 0) {options.poll_ticks = std::atoi(argv[++i]);}
+        else if (has_value && std::strcmp(argv[i], "--seed") == 0) {options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 0));}
+        else {return false;}
+    }
+    return options.ticks > 2000 && options.poll_ticks > 0;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    StressOptions options{};
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: %s [--ticks n] [--poll-ticks n] [--seed n]\n", argv[0]);
+        return 1;
+    }
+
+    const StressCase cases[] {
+        {0.05f, false},
+        {0.05f, true},
+        {0.5f, false},
+        {0.5f, true},
+        {1.0f, false},
+        {1.0f, true},
+    };
+    std::printf("%10s %7s %10s %10s %10s %10s %12s  %s\n", "edges/tick", "bounce", "steps", "counted", "presses", "counted", "ticks/sec", "result");
+    bool ok {true};
+    for (const StressCase& stress : cases)
+    {
+        const StressResult result {runCase(stress, options)};
+        const bool pass {result.steps == result.expected_steps && result.presses == result.expected_presses
+            && result.releases == result.expected_presses && result.alternating};
+        ok = ok && pass;
+        std::printf("%10.2f %7d %10d %10d %10d %10d %12.0f  %s\n", stress.edge_rate, stress.bounce, result.expected_steps, result.steps,
+            result.expected_presses, result.presses, options.ticks / result.seconds, pass ? "ok" : "FAIL");
+    }
+    return ok ? 0 : 1;
+}